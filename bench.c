@@ -0,0 +1,485 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "sha256.h"
+#include "sha512.h"
+#include "sha_batch.h"
+#include "sha_tree.h"
+#include "pbkdf2.h"
+#include "cdc.h"
+#include "thread_pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// throughput of every kernel and mode across message sizes, as csv (default) or json:
+//     gcc -O2 -pthread bench.c -o bench && ./bench [--json] [--max-size=<bytes>] [--min-time=<seconds>]
+//
+// single: one message at a time through init/update/final, once per compression kernel
+// oneshot: short messages through sha256_digest/sha512_digest, which skip the context when they fit one block
+// batch:  many messages of the same size through sha256_batch/sha512_batch, once per batch kernel (up to 1 MiB)
+// tree:   one message through sha256_tree/sha512_tree with 4 MiB chunks on every core (1 MiB and up)
+// cdc:    one message through the 2K:8K:64K chunker, once hashing the chunks on the calling thread and once
+//         on a pool with a worker per core (1 MiB and up)
+// pbkdf2: 32/64 byte keys with 10000 iterations, one password at a time and 16 passwords per batch call;
+//         size is 0 for these rows and per_s is derivations per second
+//
+// cycles/byte comes from the time stamp counter, so it counts reference cycles, not core cycles under turbo.
+
+static const uint64_t BENCH_SIZES[] = {0, 55, 64, 1024, 64 << 10, 1 << 20, 1 << 30};
+
+#define BENCH_ONESHOT_MAX_SIZE 1024
+#define BENCH_BATCH_MAX_SIZE (1 << 20)
+#define BENCH_BATCH_BYTES (64 << 20)
+#define BENCH_TREE_MIN_SIZE (1 << 20)
+#define BENCH_PBKDF2_ITERATIONS 10000
+#define BENCH_PBKDF2_BATCH 16
+
+typedef struct bench_options {
+    int json;
+    uint64_t max_size;
+    double min_time;
+} bench_options;
+
+typedef struct bench_result {
+    const char *algorithm;
+    const char *mode;
+    const char *kernel;
+    uint32_t threads;
+    uint64_t size;
+    uint64_t messages;
+    double seconds;
+    uint64_t cycles;
+} bench_result;
+
+// runs one batch of work, `messages` messages of `size` bytes each
+typedef void (*bench_fn) (const uint8_t *data, uint64_t size, uint64_t messages);
+
+static uint32_t bench_rows = 0;
+
+static thread_pool *bench_cdc_pool = NULL;
+
+static double bench_now (void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static uint64_t bench_cycles (void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void bench_print (const bench_options *options, const bench_result *result){
+    double total_bytes = (double) result->size * (double) result->messages;
+    double ns_per_message = result->seconds * 1e9 / (double) result->messages;
+    double mb_per_s = total_bytes / result->seconds / 1e6;
+    double cycles_per_byte = (total_bytes > 0) ? (double) result->cycles / total_bytes : 0;
+    double per_s = (double) result->messages / result->seconds;
+
+    if (options->json){
+        printf("%s  {\"algorithm\": \"%s\", \"mode\": \"%s\", \"kernel\": \"%s\", \"threads\": %u, \"size\": %llu, "
+               "\"messages\": %llu, \"ns_per_message\": %.1f, \"per_s\": %.1f, \"mb_per_s\": %.1f, \"cycles_per_byte\": ",
+               bench_rows ? ",\n" : "", result->algorithm, result->mode, result->kernel, result->threads,
+               (unsigned long long) result->size, (unsigned long long) result->messages, ns_per_message, per_s, mb_per_s);
+        if (result->cycles > 0 && total_bytes > 0){
+            printf("%.2f}", cycles_per_byte);
+        } else {
+            printf("null}");
+        }
+    } else {
+        printf("%s,%s,%s,%u,%llu,%llu,%.1f,%.1f,%.1f,", result->algorithm, result->mode, result->kernel, result->threads,
+               (unsigned long long) result->size, (unsigned long long) result->messages, ns_per_message, per_s, mb_per_s);
+        if (result->cycles > 0 && total_bytes > 0){
+            printf("%.2f\n", cycles_per_byte);
+        } else {
+            printf("\n");
+        }
+    }
+    bench_rows++;
+    fflush(stdout);
+}
+
+// repeats fn, doubling the message count, until one run takes at least min_time
+static void bench_measure (const bench_options *options, bench_result *result, bench_fn fn, const uint8_t *data,
+                           uint64_t first_messages){
+    uint64_t messages = first_messages;
+    double start;
+    uint64_t start_cycles;
+
+    for (;;){
+        start = bench_now();
+        start_cycles = bench_cycles();
+        fn(data, result->size, messages);
+        result->cycles = bench_cycles() - start_cycles;
+        result->seconds = bench_now() - start;
+        if (result->seconds >= options->min_time || result->size * messages >= (1ULL << 30)){
+            break;
+        }
+        messages *= 2;
+    }
+    result->messages = messages;
+    bench_print(options, result);
+}
+
+//****************************************************************************************************************
+
+static void bench_sha256_single (const uint8_t *data, uint64_t size, uint64_t messages){
+    sha256_ctx ctx;
+    uint8_t digest[32];
+
+    for (uint64_t i = 0; i < messages; i++){
+        sha256_init(&ctx);
+        sha256_update(&ctx, data, size);
+        sha256_final(&ctx, digest);
+    }
+}
+
+static void bench_sha512_single (const uint8_t *data, uint64_t size, uint64_t messages){
+    sha512_ctx ctx;
+    uint8_t digest[64];
+
+    for (uint64_t i = 0; i < messages; i++){
+        sha512_init(&ctx);
+        sha512_update(&ctx, data, size);
+        sha512_final(&ctx, digest);
+    }
+}
+
+static void bench_sha256_oneshot (const uint8_t *data, uint64_t size, uint64_t messages){
+    uint8_t digest[32];
+
+    for (uint64_t i = 0; i < messages; i++){
+        sha256_digest(data, size, digest);
+    }
+}
+
+static void bench_sha512_oneshot (const uint8_t *data, uint64_t size, uint64_t messages){
+    uint8_t digest[64];
+
+    for (uint64_t i = 0; i < messages; i++){
+        sha512_digest(data, size, digest);
+    }
+}
+
+// every message in a batch points at the same buffer, so big batches cost no extra memory
+static const uint8_t **bench_msgs = NULL;
+static size_t *bench_lens = NULL;
+static uint8_t (*bench_out)[64] = NULL;
+static uint64_t bench_batch_capacity = 0;
+
+static int bench_batch_prepare (const uint8_t *data, uint64_t size, uint64_t messages){
+    if (messages > bench_batch_capacity){
+        free(bench_msgs);
+        free(bench_lens);
+        free(bench_out);
+        bench_msgs = (const uint8_t **) malloc(messages * sizeof(uint8_t *));
+        bench_lens = (size_t *) malloc(messages * sizeof(size_t));
+        bench_out = malloc(messages * sizeof(*bench_out));
+        if (bench_msgs == NULL || bench_lens == NULL || bench_out == NULL){
+            bench_batch_capacity = 0;
+            return -1;
+        }
+        bench_batch_capacity = messages;
+    }
+    for (uint64_t i = 0; i < messages; i++){
+        bench_msgs[i] = data;
+        bench_lens[i] = size;
+    }
+    return 0;
+}
+
+static void bench_sha256_batch (const uint8_t *data, uint64_t size, uint64_t messages){
+    if (bench_batch_prepare(data, size, messages) == 0){
+        sha256_batch(bench_msgs, bench_lens, messages, (uint8_t (*)[32]) bench_out);
+    }
+}
+
+static void bench_sha512_batch (const uint8_t *data, uint64_t size, uint64_t messages){
+    if (bench_batch_prepare(data, size, messages) == 0){
+        sha512_batch(bench_msgs, bench_lens, messages, bench_out);
+    }
+}
+
+static void bench_sha256_tree (const uint8_t *data, uint64_t size, uint64_t messages){
+    uint8_t digest[32];
+
+    for (uint64_t i = 0; i < messages; i++){
+        sha256_tree(data, size, SHA_TREE_DEFAULT_CHUNK_SIZE, 0, digest);
+    }
+}
+
+static void bench_sha512_tree (const uint8_t *data, uint64_t size, uint64_t messages){
+    uint8_t digest[64];
+
+    for (uint64_t i = 0; i < messages; i++){
+        sha512_tree(data, size, SHA_TREE_DEFAULT_CHUNK_SIZE, 0, digest);
+    }
+}
+
+static int bench_cdc_discard (void *user, const cdc_record *record){
+    (void) user;
+    (void) record;
+    return 0;
+}
+
+// the whole message is collected before one flush, as a mapped window is
+static void bench_cdc (const uint8_t *data, uint64_t size, uint64_t messages, thread_pool *pool){
+    const cdc_params params = {CDC_DEFAULT_MIN_SIZE, CDC_DEFAULT_AVG_SIZE, CDC_DEFAULT_MAX_SIZE};
+    cdc_chunker chunker;
+
+    for (uint64_t i = 0; i < messages; i++){
+        cdc_init(&chunker, &params, pool, bench_cdc_discard, NULL);
+        cdc_collect(&chunker, data, size);
+        cdc_final(&chunker);
+        cdc_free(&chunker);
+    }
+}
+
+static void bench_cdc_single (const uint8_t *data, uint64_t size, uint64_t messages){
+    bench_cdc(data, size, messages, NULL);
+}
+
+static void bench_cdc_pooled (const uint8_t *data, uint64_t size, uint64_t messages){
+    bench_cdc(data, size, messages, bench_cdc_pool);
+}
+
+// the password and salt are the first bytes of data; a batch derives BENCH_PBKDF2_BATCH keys, so `messages`
+// counts keys and always comes in whole batches
+static uint8_t bench_pbkdf2_keys[BENCH_PBKDF2_BATCH][64];
+
+static void bench_pbkdf2_sha256 (const uint8_t *data, uint64_t size, uint64_t messages){
+    (void) size;
+    for (uint64_t i = 0; i < messages; i++){
+        pbkdf2_sha256(data, 16, data + 16, 16, BENCH_PBKDF2_ITERATIONS, bench_pbkdf2_keys[0], 32);
+    }
+}
+
+static void bench_pbkdf2_sha512 (const uint8_t *data, uint64_t size, uint64_t messages){
+    (void) size;
+    for (uint64_t i = 0; i < messages; i++){
+        pbkdf2_sha512(data, 16, data + 16, 16, BENCH_PBKDF2_ITERATIONS, bench_pbkdf2_keys[0], 64);
+    }
+}
+
+static void bench_pbkdf2_batch (const uint8_t *data, uint64_t messages, uint32_t key_size){
+    const uint8_t *passwords[BENCH_PBKDF2_BATCH], *salts[BENCH_PBKDF2_BATCH];
+    size_t password_lens[BENCH_PBKDF2_BATCH], salt_lens[BENCH_PBKDF2_BATCH];
+    uint8_t *out[BENCH_PBKDF2_BATCH];
+
+    for (uint32_t i = 0; i < BENCH_PBKDF2_BATCH; i++){
+        passwords[i] = data + i;
+        password_lens[i] = 16;
+        salts[i] = data + 16 + i;
+        salt_lens[i] = 16;
+        out[i] = bench_pbkdf2_keys[i];
+    }
+    for (uint64_t i = 0; i < messages; i += BENCH_PBKDF2_BATCH){
+        if (key_size == 32){
+            pbkdf2_sha256_batch(passwords, password_lens, salts, salt_lens, BENCH_PBKDF2_BATCH, BENCH_PBKDF2_ITERATIONS,
+                                out, key_size);
+        } else {
+            pbkdf2_sha512_batch(passwords, password_lens, salts, salt_lens, BENCH_PBKDF2_BATCH, BENCH_PBKDF2_ITERATIONS,
+                                out, key_size);
+        }
+    }
+}
+
+static void bench_pbkdf2_sha256_batch (const uint8_t *data, uint64_t size, uint64_t messages){
+    (void) size;
+    bench_pbkdf2_batch(data, messages, 32);
+}
+
+static void bench_pbkdf2_sha512_batch (const uint8_t *data, uint64_t size, uint64_t messages){
+    (void) size;
+    bench_pbkdf2_batch(data, messages, 64);
+}
+
+//****************************************************************************************************************
+
+static void bench_pbkdf2 (const bench_options *options, const uint8_t *data){
+    enum sha256_kernel sha256_saved = sha256_get_kernel();
+    enum sha512_kernel sha512_saved = sha512_get_kernel();
+    bench_result result = {0};
+
+    result.size = 0;
+    result.threads = 1;
+    result.mode = "pbkdf2";
+    result.algorithm = "sha256";
+    for (uint32_t kernel = SHA256_KERNEL_AUTO + 1; kernel < SHA256_KERNEL_COUNT; kernel++){
+        if (sha256_set_kernel(kernel) == 0){
+            result.kernel = sha256_kernel_name(kernel);
+            bench_measure(options, &result, bench_pbkdf2_sha256, data, 1);
+        }
+    }
+    sha256_set_kernel(sha256_saved);
+    result.algorithm = "sha512";
+    for (uint32_t kernel = SHA512_KERNEL_AUTO + 1; kernel < SHA512_KERNEL_COUNT; kernel++){
+        if (sha512_set_kernel(kernel) == 0){
+            result.kernel = sha512_kernel_name(kernel);
+            bench_measure(options, &result, bench_pbkdf2_sha512, data, 1);
+        }
+    }
+    sha512_set_kernel(sha512_saved);
+
+    result.mode = "pbkdf2-batch";
+    for (uint32_t kernel = SHA_BATCH_KERNEL_AUTO + 1; kernel < SHA_BATCH_KERNEL_COUNT; kernel++){
+        if (sha_batch_set_kernel(kernel) != 0){
+            continue;
+        }
+        result.kernel = sha_batch_kernel_name(kernel);
+        result.algorithm = "sha256";
+        bench_measure(options, &result, bench_pbkdf2_sha256_batch, data, BENCH_PBKDF2_BATCH);
+        result.algorithm = "sha512";
+        bench_measure(options, &result, bench_pbkdf2_sha512_batch, data, BENCH_PBKDF2_BATCH);
+    }
+    sha_batch_set_kernel(SHA_BATCH_KERNEL_AUTO);
+}
+
+static void bench_size (const bench_options *options, const uint8_t *data, uint64_t size){
+    enum sha256_kernel sha256_saved = sha256_get_kernel();
+    enum sha512_kernel sha512_saved = sha512_get_kernel();
+    bench_result result = {0};
+    uint64_t batch_messages;
+
+    result.size = size;
+    result.threads = 1;
+
+    result.mode = "single";
+    result.algorithm = "sha256";
+    for (uint32_t kernel = SHA256_KERNEL_AUTO + 1; kernel < SHA256_KERNEL_COUNT; kernel++){
+        if (sha256_set_kernel(kernel) == 0){
+            result.kernel = sha256_kernel_name(kernel);
+            bench_measure(options, &result, bench_sha256_single, data, 1);
+        }
+    }
+    sha256_set_kernel(sha256_saved);
+    result.algorithm = "sha512";
+    for (uint32_t kernel = SHA512_KERNEL_AUTO + 1; kernel < SHA512_KERNEL_COUNT; kernel++){
+        if (sha512_set_kernel(kernel) == 0){
+            result.kernel = sha512_kernel_name(kernel);
+            bench_measure(options, &result, bench_sha512_single, data, 1);
+        }
+    }
+    sha512_set_kernel(sha512_saved);
+
+    if (size <= BENCH_ONESHOT_MAX_SIZE){
+        result.mode = "oneshot";
+        result.algorithm = "sha256";
+        result.kernel = sha256_kernel_name(sha256_get_kernel());
+        bench_measure(options, &result, bench_sha256_oneshot, data, 1);
+        result.algorithm = "sha512";
+        result.kernel = sha512_kernel_name(sha512_get_kernel());
+        bench_measure(options, &result, bench_sha512_oneshot, data, 1);
+    }
+
+    if (size <= BENCH_BATCH_MAX_SIZE){
+        result.mode = "batch";
+        batch_messages = (size > 0) ? BENCH_BATCH_BYTES / size : BENCH_BATCH_BYTES / 64;
+        if (batch_messages > (1 << 20)){
+            batch_messages = 1 << 20;
+        }
+        for (uint32_t kernel = SHA_BATCH_KERNEL_AUTO + 1; kernel < SHA_BATCH_KERNEL_COUNT; kernel++){
+            if (sha_batch_set_kernel(kernel) != 0){
+                continue;
+            }
+            result.kernel = sha_batch_kernel_name(kernel);
+            result.algorithm = "sha256";
+            bench_measure(options, &result, bench_sha256_batch, data, batch_messages);
+            result.algorithm = "sha512";
+            bench_measure(options, &result, bench_sha512_batch, data, batch_messages);
+        }
+        sha_batch_set_kernel(SHA_BATCH_KERNEL_AUTO);
+    }
+
+    if (size >= BENCH_TREE_MIN_SIZE){
+        result.mode = "tree";
+        result.threads = thread_pool_default_threads();
+        result.algorithm = "sha256";
+        result.kernel = sha256_kernel_name(sha256_get_kernel());
+        bench_measure(options, &result, bench_sha256_tree, data, 1);
+        result.algorithm = "sha512";
+        result.kernel = sha512_kernel_name(sha512_get_kernel());
+        bench_measure(options, &result, bench_sha512_tree, data, 1);
+
+        result.mode = "cdc";
+        result.algorithm = "sha256";
+        result.kernel = sha_batch_kernel_name(sha256_batch_get_kernel());
+        result.threads = 1;
+        bench_measure(options, &result, bench_cdc_single, data, 1);
+        if (bench_cdc_pool != NULL){
+            result.threads = thread_pool_default_threads();
+            bench_measure(options, &result, bench_cdc_pooled, data, 1);
+        }
+    }
+}
+
+int main (int argc, char *argv[]){
+    bench_options options = {0, 1ULL << 30, 0.25};
+    uint64_t largest = 0;
+    uint8_t *data;
+
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--json") == 0){
+            options.json = 1;
+        } else if (strcmp(argv[i], "--csv") == 0){
+            options.json = 0;
+        } else if (strncmp(argv[i], "--max-size=", 11) == 0){
+            options.max_size = strtoull(argv[i] + 11, NULL, 10);
+        } else if (strncmp(argv[i], "--min-time=", 11) == 0){
+            options.min_time = strtod(argv[i] + 11, NULL);
+        } else {
+            fprintf(stderr, "Use: %s [--csv|--json] [--max-size=<bytes>] [--min-time=<seconds>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (size_t s = 0; s < sizeof(BENCH_SIZES) / sizeof(BENCH_SIZES[0]); s++){
+        if (BENCH_SIZES[s] <= options.max_size && BENCH_SIZES[s] > largest){
+            largest = BENCH_SIZES[s];
+        }
+    }
+    // pbkdf2 takes its password and salt from the first 48 bytes
+    if (largest < 64){
+        largest = 64;
+    }
+    if ((data = (uint8_t *) malloc(largest)) == NULL){
+        fprintf(stderr, "Error: could not allocate %llu bytes, try a smaller --max-size\n", (unsigned long long) largest);
+        return EXIT_FAILURE;
+    }
+    for (uint64_t i = 0; i < largest; i++){
+        data[i] = (uint8_t) (i * 2654435761u >> 13);
+    }
+
+    if (options.json){
+        printf("[\n");
+    } else {
+        printf("algorithm,mode,kernel,threads,size,messages,ns_per_message,per_s,mb_per_s,cycles_per_byte\n");
+    }
+    bench_cdc_pool = thread_pool_create(thread_pool_default_threads());
+    for (size_t s = 0; s < sizeof(BENCH_SIZES) / sizeof(BENCH_SIZES[0]); s++){
+        if (BENCH_SIZES[s] <= options.max_size){
+            bench_size(&options, data, BENCH_SIZES[s]);
+        }
+    }
+    bench_pbkdf2(&options, data);
+    if (options.json){
+        printf("\n]\n");
+    }
+
+    if (bench_cdc_pool != NULL){
+        thread_pool_destroy(bench_cdc_pool);
+    }
+    free(data);
+    free(bench_msgs);
+    free(bench_lens);
+    free(bench_out);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
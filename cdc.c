@@ -0,0 +1,247 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cdc.h"
+#include "sha256.h"
+#include "sha_batch.h"
+#include "thread_pool.h"
+
+typedef struct cdc_hash_job {
+    cdc_pending *chunks;
+    size_t count;
+} cdc_hash_job;
+
+// the gear table only has to look random and be the same everywhere, so it comes from splitmix64 with a fixed
+// seed instead of a 256 entry literal
+static void cdc_fill_gear (uint64_t gear[256]){
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+
+    for (uint32_t i = 0; i < 256; i++){
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+// a mask of the top `bits` bits; new bytes enter fp at the bottom, so the top bits depend on the last 64 bytes
+static uint64_t cdc_top_mask (uint32_t bits){
+    return (bits == 0) ? 0 : ~0ULL << (64 - bits);
+}
+
+// returns -1 when the sizes are out of order or too small for the gear window to matter
+int cdc_init (cdc_chunker *chunker, const cdc_params *params, thread_pool *pool, cdc_emit_fn emit, void *user){
+    uint32_t bits = 0;
+
+    if (params->min_size < 64 || params->min_size > params->avg_size || params->avg_size > params->max_size){
+        return -1;
+    }
+    while ((2ULL << bits) <= params->avg_size){
+        bits++;
+    }
+
+    memset(chunker, 0, sizeof(*chunker));
+    chunker->params = *params;
+    // normalized chunking level 2: two bits stricter before the average size and two bits looser after it
+    chunker->mask_small = cdc_top_mask(bits + 2);
+    chunker->mask_large = cdc_top_mask(bits > 2 ? bits - 2 : 1);
+    cdc_fill_gear(chunker->gear);
+    chunker->pool = pool;
+    chunker->emit = emit;
+    chunker->user = user;
+    sha256_init(&chunker->carry);
+    return 0;
+}
+
+// rolls over data until a cut point; returns how many bytes belong to the current chunk and sets *cut when the
+// chunk ends there. the chunk size and fingerprint carry over to the next call when it does not.
+static uint64_t cdc_scan (cdc_chunker *chunker, const uint8_t *data, uint64_t size, int *cut){
+    const cdc_params *params = &chunker->params;
+    uint64_t fingerprint = chunker->fingerprint;
+    uint64_t length = chunker->chunk_size;
+    uint64_t i = 0;
+
+    *cut = 0;
+    if (length < params->min_size){
+        uint64_t skip = params->min_size - length;
+        if (skip > size){
+            skip = size;
+        }
+        i += skip;
+        length += skip;
+    }
+    for (; i < size && length < params->avg_size; i++, length++){
+        fingerprint = (fingerprint << 1) + chunker->gear[data[i]];
+        if ((fingerprint & chunker->mask_small) == 0){
+            *cut = 1;
+            i++;
+            length++;
+            break;
+        }
+    }
+    for (; !*cut && i < size && length < params->max_size; i++, length++){
+        fingerprint = (fingerprint << 1) + chunker->gear[data[i]];
+        if ((fingerprint & chunker->mask_large) == 0){
+            *cut = 1;
+            i++;
+            length++;
+            break;
+        }
+    }
+    if (length >= params->max_size){
+        *cut = 1;
+    }
+
+    chunker->fingerprint = *cut ? 0 : fingerprint;
+    chunker->chunk_size = *cut ? 0 : length;
+    return i;
+}
+
+static void cdc_hash_group (void *arg){
+    cdc_hash_job *job = (cdc_hash_job *) arg;
+    const uint8_t *msgs[CDC_HASH_GROUP];
+    size_t lens[CDC_HASH_GROUP];
+    uint8_t digests[CDC_HASH_GROUP][32];
+
+    size_t count = 0;
+
+    for (size_t i = 0; i < job->count; i++){
+        if (job->chunks[i].data != NULL){
+            msgs[count] = job->chunks[i].data;
+            lens[count++] = (size_t) job->chunks[i].record.length;
+        }
+    }
+    sha256_batch(msgs, lens, count, digests);
+    count = 0;
+    for (size_t i = 0; i < job->count; i++){
+        if (job->chunks[i].data != NULL){
+            memcpy(job->chunks[i].record.digest, digests[count++], 32);
+        }
+    }
+}
+
+// hashes the chunks collected since the last flush, spread over the pool when there is more than one group, then
+// emits them in order. the data they were collected from must still be valid.
+int cdc_flush (cdc_chunker *chunker){
+    size_t groups = (chunker->pending_count + CDC_HASH_GROUP - 1) / CDC_HASH_GROUP;
+    cdc_hash_job *jobs;
+    int result = 0;
+
+    if (chunker->pending_count == 0){
+        return 0;
+    }
+    if ((jobs = (cdc_hash_job *) malloc(groups * sizeof(cdc_hash_job))) == NULL){
+        return -1;
+    }
+    for (size_t g = 0; g < groups; g++){
+        jobs[g].chunks = chunker->pending + g * CDC_HASH_GROUP;
+        jobs[g].count = (g + 1 < groups) ? CDC_HASH_GROUP : chunker->pending_count - g * CDC_HASH_GROUP;
+        if (chunker->pool != NULL && groups > 1){
+            thread_pool_submit(chunker->pool, cdc_hash_group, &jobs[g]);
+        } else {
+            cdc_hash_group(&jobs[g]);
+        }
+    }
+    if (chunker->pool != NULL && groups > 1){
+        thread_pool_wait(chunker->pool);
+    }
+    free(jobs);
+
+    for (size_t i = 0; i < chunker->pending_count && result == 0; i++){
+        result = chunker->emit(chunker->user, &chunker->pending[i].record);
+    }
+    chunker->pending_count = 0;
+    return result;
+}
+
+static int cdc_add_pending (cdc_chunker *chunker, const uint8_t *data, uint64_t offset, uint64_t length){
+    if (chunker->pending_count == chunker->pending_capacity){
+        size_t capacity = chunker->pending_capacity ? 2 * chunker->pending_capacity : CDC_HASH_GROUP;
+        cdc_pending *pending = (cdc_pending *) realloc(chunker->pending, capacity * sizeof(cdc_pending));
+        if (pending == NULL){
+            return -1;
+        }
+        chunker->pending = pending;
+        chunker->pending_capacity = capacity;
+    }
+    chunker->pending[chunker->pending_count].data = data;
+    chunker->pending[chunker->pending_count].record.offset = offset;
+    chunker->pending[chunker->pending_count].record.length = length;
+    chunker->pending_count++;
+    return 0;
+}
+
+// finds the chunks in data without hashing them. a chunk that started in an earlier call is finished on the
+// streaming carry context, chunks that lie wholly inside data are queued for cdc_flush, which hashes them
+// straight from data, and the unfinished tail is absorbed into the carry context. collecting several pieces of
+// one buffer before a flush gives the pool more than one group to work on.
+int cdc_collect (cdc_chunker *chunker, const uint8_t *data, uint64_t size){
+    uint64_t used;
+    int cut;
+
+    if (chunker->chunk_size > 0 && size > 0){
+        used = cdc_scan(chunker, data, size, &cut);
+        sha256_update(&chunker->carry, data, used);
+        if (cut){
+            uint64_t length = chunker->carry.data_size_bytes;
+            if (cdc_add_pending(chunker, NULL, chunker->offset - (length - used), length) != 0){
+                return -1;
+            }
+            sha256_final(&chunker->carry, chunker->pending[chunker->pending_count - 1].record.digest);
+            sha256_init(&chunker->carry);
+        }
+        data += used;
+        size -= used;
+        chunker->offset += used;
+    }
+
+    while (size > 0){
+        used = cdc_scan(chunker, data, size, &cut);
+        if (!cut){
+            sha256_update(&chunker->carry, data, used);
+            chunker->offset += used;
+            break;
+        }
+        if (cdc_add_pending(chunker, data, chunker->offset, used) != 0){
+            return -1;
+        }
+        data += used;
+        size -= used;
+        chunker->offset += used;
+    }
+    return 0;
+}
+
+// an sha_io consumer: collects the chunks of data and hashes them before returning, so nothing is copied or kept
+// past the call
+int cdc_update (void *arg, const uint8_t *data, uint64_t size){
+    cdc_chunker *chunker = (cdc_chunker *) arg;
+
+    if (cdc_collect(chunker, data, size) != 0){
+        return -1;
+    }
+    return cdc_flush(chunker);
+}
+
+// emits the chunks still pending and then the last chunk; the data does not need to end on a cut point, and an
+// empty input has no chunks
+int cdc_final (cdc_chunker *chunker){
+    cdc_record record;
+    int result = cdc_flush(chunker);
+
+    if (result != 0 || chunker->chunk_size == 0){
+        return result;
+    }
+    record.length = chunker->carry.data_size_bytes;
+    record.offset = chunker->offset - record.length;
+    sha256_final(&chunker->carry, record.digest);
+    chunker->chunk_size = 0;
+    return chunker->emit(chunker->user, &record);
+}
+
+void cdc_free (cdc_chunker *chunker){
+    free(chunker->pending);
+    chunker->pending = NULL;
+    chunker->pending_count = 0;
+    chunker->pending_capacity = 0;
+}
\ No newline at end of file
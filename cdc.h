@@ -0,0 +1,76 @@
+#ifndef CDC_H
+#define CDC_H
+#include <stdint.h>
+#include <stddef.h>
+#include "sha256.h"
+#include "sha_batch.h"
+#include "thread_pool.h"
+
+// Content-defined chunking (FastCDC style) with a sha256 per chunk.
+//
+// a gear hash rolls over the input, fp = (fp << 1) + GEAR[byte], and a chunk ends where the top bits of fp are
+// all zero. no cut is looked for in the first min_size bytes of a chunk; up to avg_size a stricter mask is used
+// and after it a looser one, which keeps chunk sizes close to avg_size; a chunk never grows past max_size.
+// the cut points only depend on the bytes, never on how the input was split into update calls.
+
+#define CDC_DEFAULT_MIN_SIZE (2 << 10)
+#define CDC_DEFAULT_AVG_SIZE (8 << 10)
+#define CDC_DEFAULT_MAX_SIZE (64 << 10)
+
+// chunks collected since the last flush are hashed together, this many per batch call or pool task
+#define CDC_HASH_GROUP 64
+
+typedef struct cdc_params {
+    uint64_t min_size;
+    uint64_t avg_size;
+    uint64_t max_size;
+} cdc_params;
+
+typedef struct cdc_record {
+    uint64_t offset;
+    uint64_t length;
+    uint8_t digest[32];
+} cdc_record;
+
+// receives the chunks in stream order; a non-zero return stops the chunker
+typedef int (*cdc_emit_fn) (void *user, const cdc_record *record);
+
+// a chunk waiting for cdc_flush, hashed in place from data; data is NULL for a chunk finished on the carry
+// context, whose digest is already set
+typedef struct cdc_pending {
+    const uint8_t *data;
+    cdc_record record;
+} cdc_pending;
+
+typedef struct cdc_chunker {
+    cdc_params params;
+    uint64_t mask_small;
+    uint64_t mask_large;
+    uint64_t gear[256];
+    uint64_t fingerprint;
+    uint64_t offset;
+    uint64_t chunk_size;
+    sha256_ctx carry;
+    cdc_pending *pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    thread_pool *pool;
+    cdc_emit_fn emit;
+    void *user;
+} cdc_chunker;
+
+#include "cdc.c"
+
+int cdc_init (cdc_chunker *chunker, const cdc_params *params, thread_pool *pool, cdc_emit_fn emit, void *user);
+
+int cdc_update (void *chunker, const uint8_t *data, uint64_t size);
+
+int cdc_collect (cdc_chunker *chunker, const uint8_t *data, uint64_t size);
+
+int cdc_flush (cdc_chunker *chunker);
+
+int cdc_final (cdc_chunker *chunker);
+
+void cdc_free (cdc_chunker *chunker);
+
+#endif
\ No newline at end of file
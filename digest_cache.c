@@ -0,0 +1,207 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "digest_cache.h"
+#include "sha_io.h"
+
+static void digest_cache_entry_key (digest_cache_entry *entry, const struct stat *file_status, uint32_t algorithm){
+    memset(entry, 0, sizeof(*entry));
+    entry->dev = (uint64_t) file_status->st_dev;
+    entry->inode = (uint64_t) file_status->st_ino;
+    entry->size = (uint64_t) file_status->st_size;
+    entry->mtime_ns = (uint64_t) file_status->st_mtim.tv_sec * 1000000000ULL + (uint64_t) file_status->st_mtim.tv_nsec;
+    entry->algorithm = algorithm;
+}
+
+static int digest_cache_compare (const void *first, const void *second){
+    const digest_cache_entry *x = (const digest_cache_entry *) first, *y = (const digest_cache_entry *) second;
+
+    if (x->dev != y->dev){
+        return (x->dev < y->dev) ? -1 : 1;
+    }
+    if (x->inode != y->inode){
+        return (x->inode < y->inode) ? -1 : 1;
+    }
+    if (x->algorithm != y->algorithm){
+        return (x->algorithm < y->algorithm) ? -1 : 1;
+    }
+    return 0;
+}
+
+// a missing cache is an empty one, and so is a file this version cannot read; it is replaced on the next save.
+// returns -1 only when out of memory.
+int digest_cache_open (digest_cache *cache, const char *path){
+    const digest_cache_header *header;
+
+    struct timespec now;
+
+    memset(cache, 0, sizeof(*cache));
+    pthread_mutex_init(&cache->lock, NULL);
+    // whole seconds, so filesystems that only keep seconds in mtime are covered as well
+    clock_gettime(CLOCK_REALTIME, &now);
+    cache->scan_start_ns = (uint64_t) now.tv_sec * 1000000000ULL;
+    if ((cache->path = strdup(path)) == NULL){
+        return -1;
+    }
+    if (sha_io_map_path(path, &cache->map, &cache->map_size) != 0){
+        return 0;
+    }
+
+    header = (const digest_cache_header *) cache->map;
+    if (cache->map_size < sizeof(digest_cache_header) || memcmp(header->magic, DIGEST_CACHE_MAGIC, 8) != 0 ||
+        header->version != DIGEST_CACHE_VERSION || header->entry_size != sizeof(digest_cache_entry) ||
+        header->count > (cache->map_size - sizeof(digest_cache_header)) / sizeof(digest_cache_entry)){
+        fprintf(stderr, "Warning: ignoring unreadable cache %s\n", path);
+        sha_io_unmap(cache->map, cache->map_size);
+        cache->map = NULL;
+        cache->map_size = 0;
+        return 0;
+    }
+    cache->entries = (const digest_cache_entry *) (cache->map + sizeof(digest_cache_header));
+    cache->count = header->count;
+    return 0;
+}
+
+// returns 0 and fills digest when the file still has the size and mtime it had when it was hashed
+int digest_cache_lookup (const digest_cache *cache, const struct stat *file_status, uint32_t algorithm,
+                         uint8_t *digest, uint32_t digest_size){
+    digest_cache_entry key;
+    const digest_cache_entry *entry;
+
+    if (cache->count == 0){
+        return -1;
+    }
+    digest_cache_entry_key(&key, file_status, algorithm);
+    entry = (const digest_cache_entry *) bsearch(&key, cache->entries, cache->count, sizeof(digest_cache_entry),
+                                                 digest_cache_compare);
+    if (entry == NULL || entry->size != key.size || entry->mtime_ns != key.mtime_ns || entry->digest_size != digest_size){
+        return -1;
+    }
+    memcpy(digest, entry->digest, digest_size);
+    return 0;
+}
+
+// safe to call from several threads; file_status should be taken before the file was read, so a change made
+// while hashing gives a different mtime next time. like the git index, files modified in the second the scan
+// started or later are not stored: another write within the same timestamp tick would leave size and mtime
+// unchanged, and the stale digest would be served from then on
+int digest_cache_store (digest_cache *cache, const struct stat *file_status, uint32_t algorithm,
+                        const uint8_t *digest, uint32_t digest_size){
+    digest_cache_entry entry;
+    int result = 0;
+
+    digest_cache_entry_key(&entry, file_status, algorithm);
+    if (entry.mtime_ns >= cache->scan_start_ns){
+        return 0;
+    }
+    entry.digest_size = digest_size;
+    memcpy(entry.digest, digest, digest_size);
+
+    pthread_mutex_lock(&cache->lock);
+    if (cache->added_count == cache->added_capacity){
+        size_t capacity = cache->added_capacity ? 2 * cache->added_capacity : 256;
+        digest_cache_entry *added = (digest_cache_entry *) realloc(cache->added, capacity * sizeof(digest_cache_entry));
+        if (added == NULL){
+            result = -1;
+        } else {
+            cache->added = added;
+            cache->added_capacity = capacity;
+        }
+    }
+    if (result == 0){
+        cache->added[cache->added_count++] = entry;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return result;
+}
+
+// merges the new entries into the mapped ones, a new entry replacing an old one with the same key, and writes
+// the result next to the cache before renaming it over, so a crash leaves either the old or the new cache
+int digest_cache_save (digest_cache *cache){
+    digest_cache_header header;
+    char *temp_path;
+    FILE *file;
+    uint64_t old = 0, count = 0;
+    size_t added = 0;
+    int result = 0;
+
+    if (cache->added_count == 0){
+        return 0;
+    }
+    qsort(cache->added, cache->added_count, sizeof(digest_cache_entry), digest_cache_compare);
+
+    if ((temp_path = (char *) malloc(strlen(cache->path) + 32)) == NULL){
+        return -1;
+    }
+    sprintf(temp_path, "%s.tmp.%ld", cache->path, (long) getpid());
+    if ((file = fopen(temp_path, "wb")) == NULL){
+        free(temp_path);
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DIGEST_CACHE_MAGIC, 8);
+    header.version = DIGEST_CACHE_VERSION;
+    header.entry_size = sizeof(digest_cache_entry);
+    fwrite(&header, sizeof(header), 1, file);
+
+    while (old < cache->count || added < cache->added_count){
+        const digest_cache_entry *entry;
+        int order;
+
+        if (old == cache->count){
+            order = 1;
+        } else if (added == cache->added_count){
+            order = -1;
+        } else {
+            order = digest_cache_compare(&cache->entries[old], &cache->added[added]);
+        }
+        if (order < 0){
+            entry = &cache->entries[old++];
+        } else {
+            // a file given twice in one run is written once
+            while (added + 1 < cache->added_count && digest_cache_compare(&cache->added[added], &cache->added[added + 1]) == 0){
+                added++;
+            }
+            entry = &cache->added[added++];
+            if (order == 0){
+                old++;
+            }
+        }
+        fwrite(entry, sizeof(digest_cache_entry), 1, file);
+        count++;
+    }
+
+    header.count = count;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    if (fflush(file) != 0 || fsync(fileno(file)) != 0 || ferror(file)){
+        result = -1;
+    }
+    if (fclose(file) != 0){
+        result = -1;
+    }
+    if (result == 0 && rename(temp_path, cache->path) != 0){
+        result = -1;
+    }
+    if (result != 0){
+        unlink(temp_path);
+    }
+    free(temp_path);
+    return result;
+}
+
+void digest_cache_close (digest_cache *cache){
+    if (cache->map != NULL){
+        sha_io_unmap(cache->map, cache->map_size);
+    }
+    free(cache->added);
+    free(cache->path);
+    pthread_mutex_destroy(&cache->lock);
+    memset(cache, 0, sizeof(*cache));
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef DIGEST_CACHE_H
+#define DIGEST_CACHE_H
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// On-disk digest cache, so unchanged files are not read again.
+//
+// the file is a header followed by fixed-size entries sorted by (dev, inode, algorithm), mapped read-only and
+// binary searched. an entry only counts when the size and the nanosecond mtime still match the file. new digests
+// are kept in memory and merged into a fresh file that replaces the old one with rename(), so readers only ever
+// see a complete cache. files modified in the second the scan started or later are never stored, since another
+// write could leave their mtime unchanged. entries use the byte order of the machine that wrote them.
+
+#define DIGEST_CACHE_MAGIC "shcache"
+#define DIGEST_CACHE_VERSION 1
+
+typedef struct digest_cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t count;
+} digest_cache_header;
+
+typedef struct digest_cache_entry {
+    uint64_t dev;
+    uint64_t inode;
+    uint64_t size;
+    uint64_t mtime_ns;
+    uint32_t algorithm;
+    uint32_t digest_size;
+    uint8_t digest[64];
+} digest_cache_entry;
+
+typedef struct digest_cache {
+    char *path;
+    const uint8_t *map;
+    uint64_t map_size;
+    const digest_cache_entry *entries;
+    uint64_t count;
+    digest_cache_entry *added;
+    size_t added_count;
+    size_t added_capacity;
+    pthread_mutex_t lock;
+    uint64_t scan_start_ns;
+} digest_cache;
+
+#include "digest_cache.c"
+
+int digest_cache_open (digest_cache *cache, const char *path);
+
+int digest_cache_lookup (const digest_cache *cache, const struct stat *file_status, uint32_t algorithm,
+                         uint8_t *digest, uint32_t digest_size);
+
+int digest_cache_store (digest_cache *cache, const struct stat *file_status, uint32_t algorithm,
+                        const uint8_t *digest, uint32_t digest_size);
+
+int digest_cache_save (digest_cache *cache);
+
+void digest_cache_close (digest_cache *cache);
+
+#endif
\ No newline at end of file
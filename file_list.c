@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "file_list.h"
+
+static int file_list_append (file_list *list, const char *path){
+    char *copy;
+
+    if (list->count == list->capacity){
+        size_t capacity = list->capacity ? 2 * list->capacity : 64;
+        char **paths = (char **) realloc(list->paths, capacity * sizeof(char *));
+        if (paths == NULL){
+            return -1;
+        }
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    if ((copy = strdup(path)) == NULL){
+        return -1;
+    }
+    list->paths[list->count++] = copy;
+    return 0;
+}
+
+static int file_list_keep_entry (const struct dirent *entry){
+    return strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0;
+}
+
+// directories are walked recursively in sorted order so the output order never depends on the filesystem.
+// symlinks are followed for files but not for directories, which keeps the walk free of cycles.
+// anything else, including paths that do not exist, is added as is and reported when it is opened.
+int file_list_add_path (file_list *list, const char *path){
+    struct stat path_status;
+    struct dirent **entries;
+    int num_entries, result = 0;
+
+    if (stat(path, &path_status) != 0 || !S_ISDIR(path_status.st_mode)){
+        return file_list_append(list, path);
+    }
+    if ((num_entries = scandir(path, &entries, file_list_keep_entry, alphasort)) < 0){
+        return file_list_append(list, path);
+    }
+
+    for (int i = 0; i < num_entries; i++){
+        size_t path_len = strlen(path);
+        char *child = (char *) malloc(path_len + strlen(entries[i]->d_name) + 2);
+
+        if (child == NULL){
+            result = -1;
+        } else {
+            struct stat child_status;
+            int separator = path_len > 0 && path[path_len - 1] != '/';
+            int linked_directory;
+
+            sprintf(child, "%s%s%s", path, separator ? "/" : "", entries[i]->d_name);
+            linked_directory = lstat(child, &child_status) == 0 && S_ISLNK(child_status.st_mode) &&
+                               stat(child, &child_status) == 0 && S_ISDIR(child_status.st_mode);
+            if (!linked_directory && result == 0){
+                result = file_list_add_path(list, child);
+            }
+            free(child);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+    return result;
+}
+
+void file_list_free (file_list *list){
+    for (size_t i = 0; i < list->count; i++){
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    list->paths = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef FILE_LIST_H
+#define FILE_LIST_H
+#include <stddef.h>
+
+// paths to hash, in the order they will be printed
+typedef struct file_list {
+    char **paths;
+    size_t count;
+    size_t capacity;
+} file_list;
+
+#include "file_list.c"
+
+int file_list_add_path (file_list *list, const char *path);
+
+void file_list_free (file_list *list);
+
+#endif
\ No newline at end of file
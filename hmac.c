@@ -0,0 +1,210 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "hmac.h"
+#include "sha256.h"
+#include "sha512.h"
+#include "sha_batch.h"
+#include "sha_helpers.h"
+
+#define HMAC_IPAD 0x36
+#define HMAC_OPAD 0x5c
+
+// keys longer than a block are hashed first, shorter ones are zero padded to the block size
+void hmac_sha256_set_key(hmac_sha256_key *key, const uint8_t *secret, uint64_t secret_size_bytes){
+    uint8_t block[64] = {0};
+    uint8_t padded[64];
+    sha256_ctx ctx;
+
+    if (secret_size_bytes > 64){
+        sha256_init(&ctx);
+        sha256_update(&ctx, secret, secret_size_bytes);
+        sha256_final(&ctx, block);
+    } else {
+        memcpy(block, secret, secret_size_bytes);
+    }
+
+    for (uint32_t i = 0; i < 8; i++){
+        key->inner[i] = SHA256_INITIAL_HASH_VAL[i];
+        key->outer[i] = SHA256_INITIAL_HASH_VAL[i];
+    }
+    for (uint32_t i = 0; i < 64; i++){
+        padded[i] = block[i] ^ HMAC_IPAD;
+    }
+    sha256_compress_blocks(key->inner, padded, 1);
+    for (uint32_t i = 0; i < 64; i++){
+        padded[i] = block[i] ^ HMAC_OPAD;
+    }
+    sha256_compress_blocks(key->outer, padded, 1);
+
+    sha_wipe(block, sizeof(block));
+    sha_wipe(padded, sizeof(padded));
+    sha_wipe(&ctx, sizeof(ctx));
+}
+
+// wipes a context that is abandoned before final; final already does this
+void hmac_sha256_clear(hmac_sha256_ctx *ctx){
+    sha_wipe(ctx, sizeof(*ctx));
+}
+
+// wipes the midstates, which are as good as the key itself
+void hmac_sha256_key_clear(hmac_sha256_key *key){
+    sha_wipe(key, sizeof(*key));
+}
+
+// the inner hash continues from the ipad midstate as if the key block had just been absorbed
+void hmac_sha256_init(hmac_sha256_ctx *ctx, const hmac_sha256_key *key){
+    sha256_init(&ctx->inner);
+    memcpy(ctx->inner.hash, key->inner, sizeof(ctx->inner.hash));
+    ctx->inner.data_size_bytes = 64;
+    ctx->key = key;
+}
+
+void hmac_sha256_update(hmac_sha256_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes){
+    sha256_update(&ctx->inner, data, data_size_bytes);
+}
+
+// the outer hash is the opad midstate plus one block: the inner digest, padded for a 96 byte message
+void hmac_sha256_final(hmac_sha256_ctx *ctx, uint8_t mac[32]){
+    uint8_t inner_digest[32], padding[128];
+    uint32_t hash[8];
+
+    sha256_final(&ctx->inner, inner_digest);
+    memcpy(hash, ctx->key->outer, sizeof(hash));
+    sha256_pad(padding, inner_digest, 32, 64 + 32);
+    sha256_compress_blocks(hash, padding, 1);
+    for (uint32_t i = 0; i < 8; i++){
+        store_be32(mac + 4 * i, hash[i]);
+    }
+
+    sha_wipe(inner_digest, sizeof(inner_digest));
+    sha_wipe(padding, sizeof(padding));
+    sha_wipe(hash, sizeof(hash));
+    hmac_sha256_clear(ctx);
+}
+
+void hmac_sha256(const hmac_sha256_key *key, const uint8_t *data, uint64_t data_size_bytes, uint8_t mac[32]){
+    hmac_sha256_ctx ctx;
+
+    hmac_sha256_init(&ctx, key);
+    hmac_sha256_update(&ctx, data, data_size_bytes);
+    hmac_sha256_final(&ctx, mac);
+}
+
+// n macs under one key through the multi-buffer kernels: the inner hashes of a group run side by side from the
+// ipad midstate, then their digests go through the lanes again from the opad midstate
+void hmac_sha256_batch(const hmac_sha256_key *key, const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[32]){
+    uint8_t inner[HMAC_BATCH_GROUP][32];
+    const uint8_t *inner_msgs[HMAC_BATCH_GROUP];
+    size_t inner_lens[HMAC_BATCH_GROUP];
+
+    for (size_t first = 0; first < n; first += HMAC_BATCH_GROUP){
+        size_t count = (n - first < HMAC_BATCH_GROUP) ? n - first : HMAC_BATCH_GROUP;
+
+        sha256_batch_from(key->inner, 64, msgs + first, lens + first, count, inner);
+        for (size_t i = 0; i < count; i++){
+            inner_msgs[i] = inner[i];
+            inner_lens[i] = 32;
+        }
+        sha256_batch_from(key->outer, 64, inner_msgs, inner_lens, count, out + first);
+    }
+    sha_wipe(inner, sizeof(inner));
+}
+
+//****************************************************************************************************************
+
+void hmac_sha512_set_key(hmac_sha512_key *key, const uint8_t *secret, uint64_t secret_size_bytes){
+    uint8_t block[128] = {0};
+    uint8_t padded[128];
+    sha512_ctx ctx;
+
+    if (secret_size_bytes > 128){
+        sha512_init(&ctx);
+        sha512_update(&ctx, secret, secret_size_bytes);
+        sha512_final(&ctx, block);
+    } else {
+        memcpy(block, secret, secret_size_bytes);
+    }
+
+    for (uint32_t i = 0; i < 8; i++){
+        key->inner[i] = SHA512_INITIAL_HASH_VAL[i];
+        key->outer[i] = SHA512_INITIAL_HASH_VAL[i];
+    }
+    for (uint32_t i = 0; i < 128; i++){
+        padded[i] = block[i] ^ HMAC_IPAD;
+    }
+    sha512_compress_blocks(key->inner, padded, 1);
+    for (uint32_t i = 0; i < 128; i++){
+        padded[i] = block[i] ^ HMAC_OPAD;
+    }
+    sha512_compress_blocks(key->outer, padded, 1);
+
+    sha_wipe(block, sizeof(block));
+    sha_wipe(padded, sizeof(padded));
+    sha_wipe(&ctx, sizeof(ctx));
+}
+
+// wipes a context that is abandoned before final; final already does this
+void hmac_sha512_clear(hmac_sha512_ctx *ctx){
+    sha_wipe(ctx, sizeof(*ctx));
+}
+
+// wipes the midstates, which are as good as the key itself
+void hmac_sha512_key_clear(hmac_sha512_key *key){
+    sha_wipe(key, sizeof(*key));
+}
+
+void hmac_sha512_init(hmac_sha512_ctx *ctx, const hmac_sha512_key *key){
+    sha512_init(&ctx->inner);
+    memcpy(ctx->inner.hash, key->inner, sizeof(ctx->inner.hash));
+    ctx->inner.data_size_bytes = 128;
+    ctx->key = key;
+}
+
+void hmac_sha512_update(hmac_sha512_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes){
+    sha512_update(&ctx->inner, data, data_size_bytes);
+}
+
+void hmac_sha512_final(hmac_sha512_ctx *ctx, uint8_t mac[64]){
+    uint8_t inner_digest[64], padding[256];
+    uint64_t hash[8];
+
+    sha512_final(&ctx->inner, inner_digest);
+    memcpy(hash, ctx->key->outer, sizeof(hash));
+    sha512_pad(padding, inner_digest, 64, 128 + 64);
+    sha512_compress_blocks(hash, padding, 1);
+    for (uint32_t i = 0; i < 8; i++){
+        store_be64(mac + 8 * i, hash[i]);
+    }
+
+    sha_wipe(inner_digest, sizeof(inner_digest));
+    sha_wipe(padding, sizeof(padding));
+    sha_wipe(hash, sizeof(hash));
+    hmac_sha512_clear(ctx);
+}
+
+void hmac_sha512(const hmac_sha512_key *key, const uint8_t *data, uint64_t data_size_bytes, uint8_t mac[64]){
+    hmac_sha512_ctx ctx;
+
+    hmac_sha512_init(&ctx, key);
+    hmac_sha512_update(&ctx, data, data_size_bytes);
+    hmac_sha512_final(&ctx, mac);
+}
+
+void hmac_sha512_batch(const hmac_sha512_key *key, const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[64]){
+    uint8_t inner[HMAC_BATCH_GROUP][64];
+    const uint8_t *inner_msgs[HMAC_BATCH_GROUP];
+    size_t inner_lens[HMAC_BATCH_GROUP];
+
+    for (size_t first = 0; first < n; first += HMAC_BATCH_GROUP){
+        size_t count = (n - first < HMAC_BATCH_GROUP) ? n - first : HMAC_BATCH_GROUP;
+
+        sha512_batch_from(key->inner, 128, msgs + first, lens + first, count, inner);
+        for (size_t i = 0; i < count; i++){
+            inner_msgs[i] = inner[i];
+            inner_lens[i] = 64;
+        }
+        sha512_batch_from(key->outer, 128, inner_msgs, inner_lens, count, out + first);
+    }
+    sha_wipe(inner, sizeof(inner));
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef HMAC_H
+#define HMAC_H
+#include <stdint.h>
+#include <stddef.h>
+#include "sha256.h"
+#include "sha512.h"
+#include "sha_batch.h"
+
+// HMAC (RFC 2104) over sha256 and sha512.
+//
+// a key is prepared once: the key block xored with ipad and with opad is compressed up front and only the two
+// midstates are kept, so every mac after that costs the message blocks plus one block for the outer hash.
+
+typedef struct hmac_sha256_key {
+    uint32_t inner[8];
+    uint32_t outer[8];
+} hmac_sha256_key;
+
+typedef struct hmac_sha512_key {
+    uint64_t inner[8];
+    uint64_t outer[8];
+} hmac_sha512_key;
+
+// streaming state for one mac, the key must outlive it
+typedef struct hmac_sha256_ctx {
+    sha256_ctx inner;
+    const hmac_sha256_key *key;
+} hmac_sha256_ctx;
+
+typedef struct hmac_sha512_ctx {
+    sha512_ctx inner;
+    const hmac_sha512_key *key;
+} hmac_sha512_ctx;
+
+// batch macs are computed this many messages at a time, the inner digests of a group live on the stack
+#define HMAC_BATCH_GROUP 64
+
+#include "hmac.c"
+
+void hmac_sha256_set_key(hmac_sha256_key *key, const uint8_t *secret, uint64_t secret_size_bytes);
+
+void hmac_sha256_key_clear(hmac_sha256_key *key);
+
+void hmac_sha256_init(hmac_sha256_ctx *ctx, const hmac_sha256_key *key);
+
+void hmac_sha256_update(hmac_sha256_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes);
+
+void hmac_sha256_final(hmac_sha256_ctx *ctx, uint8_t mac[32]);
+
+void hmac_sha256_clear(hmac_sha256_ctx *ctx);
+
+void hmac_sha256(const hmac_sha256_key *key, const uint8_t *data, uint64_t data_size_bytes, uint8_t mac[32]);
+
+void hmac_sha256_batch(const hmac_sha256_key *key, const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[32]);
+
+void hmac_sha512_set_key(hmac_sha512_key *key, const uint8_t *secret, uint64_t secret_size_bytes);
+
+void hmac_sha512_key_clear(hmac_sha512_key *key);
+
+void hmac_sha512_init(hmac_sha512_ctx *ctx, const hmac_sha512_key *key);
+
+void hmac_sha512_update(hmac_sha512_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes);
+
+void hmac_sha512_final(hmac_sha512_ctx *ctx, uint8_t mac[64]);
+
+void hmac_sha512_clear(hmac_sha512_ctx *ctx);
+
+void hmac_sha512(const hmac_sha512_key *key, const uint8_t *data, uint64_t data_size_bytes, uint8_t mac[64]);
+
+void hmac_sha512_batch(const hmac_sha512_key *key, const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[64]);
+
+#endif
\ No newline at end of file
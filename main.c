@@ -1,43 +1,784 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdint.h>
-#include <sys/stat.h>
-
-#include "sha256.h"
-#include "sha512.h"
-
-int main (int argc, char *argv[]){
-    FILE *file;
-    uint64_t *digest;
-    uint8_t *data;
-    uint64_t file_size_bytes = 0;
-    struct stat file_status;
-
-    printf("%d file(s) arguments\n", argc - 1);
-    if (argc != 2){
-        printf("Error: incorrect amount of arguments. Please provide one (1) argument.\n");
-        printf("Use: %s <path_to_file\n>", argv[0]);
-        exit(EXIT_FAILURE);
-    }
-    if ((file = fopen(argv[1], "rb")) == NULL){
-        printf("Error: could not open %s\n", argv[1]);
-        exit(EXIT_FAILURE);
-    }
-
-    printf("Hashing %s\n", argv[1]);
-    stat(argv[1], &file_status);
-    file_size_bytes = file_status.st_size;
-    data = (uint8_t *) malloc(file_size_bytes * sizeof(uint8_t));
-    fread(data, sizeof(uint8_t), file_size_bytes, file);
-    fclose(file);
-
-    digest = sha512(data, file_size_bytes);
-    printf("\nDigest: ");
-    for (uint32_t i = 0; i < 32; i++){
-        printf("%02x ", digest[i]);
-    }
-    printf("\n");
-    free(digest);
-
-    return EXIT_SUCCESS;
+// tee() for --tee, see sha_io_tee_fd
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "sha256.h"
+#include "sha512.h"
+#include "sha_selftest.h"
+#include "sha_tree.h"
+#include "thread_pool.h"
+#include "file_list.h"
+#include "sha_io.h"
+#include "cdc.h"
+#include "digest_cache.h"
+#include "manifest.h"
+
+enum hash_algorithm {HASH_SHA256, HASH_SHA512};
+
+typedef struct hash_options {
+    enum hash_algorithm algorithm;
+    int tree;
+    uint64_t chunk_size;
+    uint32_t num_threads;
+    int progress;
+    int cdc;
+    cdc_params cdc_params;
+    thread_pool *cdc_pool;
+    digest_cache *cache;
+    int paranoid;
+    int fail_fast;
+    int stats;
+} hash_options;
+
+// one file to hash; workers fill in digest and result, then set done so the main thread can print it in order.
+// when checking a manifest, expected is the listed digest and the worker compares it right away
+typedef struct hash_job {
+    const char *path;
+    const hash_options *options;
+    enum hash_algorithm algorithm;
+    const uint8_t *expected;
+    uint8_t digest[64];
+    int result;
+    int mismatch;
+    int cancelled;
+    int cached;
+    int done;
+    uint64_t bytes_reported;
+    sha_stats stats;
+    uint64_t wall_ns;
+    uint64_t hash_ns;
+} hash_job;
+
+static pthread_mutex_t hash_jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hash_job_finished = PTHREAD_COND_INITIALIZER;
+
+// set by the first failed check under --fail-fast; jobs that have not started skip their file and running ones
+// stop at the next slice
+static int hash_jobs_cancelled = 0;
+
+// one bar for all files together; workers add what they hashed and whoever gets the lock redraws it
+#define PROGRESS_INTERVAL_MS 200
+
+static uint64_t progress_total_bytes = 0;
+static uint64_t progress_done_bytes = 0;
+static pthread_mutex_t progress_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// whichever of the two contexts the algorithm needs; with timed set, the time spent inside updates is added to
+// update_ns, and whatever else the read took was spent waiting for input
+typedef struct hash_state {
+    enum hash_algorithm algorithm;
+    sha256_ctx ctx256;
+    sha512_ctx ctx512;
+    int timed;
+    uint64_t update_ns;
+} hash_state;
+
+// the whole-file hash and the chunker read the same pieces, so chunking costs no second pass over the input
+#define HASH_CHUNKED_SLICE (256 << 10)
+// with a chunk pool the cut points of several slices are collected before hashing, so each flush has enough
+// groups of chunks to spread over the workers
+#define HASH_CHUNKED_POOL_BATCH (8 << 20)
+
+typedef struct hash_chunked {
+    hash_state *state;
+    cdc_chunker *chunker;
+} hash_chunked;
+
+static void print_usage (const char *program){
+    printf("Use: %s [--algo=sha256|sha512] [--threads=<n>] [--tree [--chunk=<size>[K|M|G]]] [--no-progress] <path>...\n", program);
+    printf("     %s --cdc[=<min>:<avg>:<max>] [--algo=...] [--threads=<n>] <path>...\n", program);
+    printf("     %s --cache=<file> [--paranoid] [--algo=...] [--threads=<n>] <path>...\n", program);
+    printf("     %s --check <manifest> [--fail-fast] [--threads=<n>]\n", program);
+    printf("     %s --stats[=<file>] [--algo=...] [--threads=<n>] <path>...\n", program);
+    printf("     %s --tee [--digest-file=<file>] [--algo=...]\n", program);
+    printf("     %s --self-test\n", program);
+    printf("Directories are hashed recursively, - or no path reads stdin. Output is one \"<hex>  <path>\" line per file, in argument order.\n");
+    printf("With --cdc each file is also cut into content-defined chunks (default 2K:8K:64K), printed before the file\n");
+    printf("as \"<sha256 hex> <offset> <length>\" lines.\n");
+    printf("With --cache, files whose device, inode, size and mtime match the cache are not read again; --paranoid\n");
+    printf("reads every file anyway and refreshes the cache.\n");
+    printf("With --check, the files listed in a sha256sum or sha512sum manifest are verified and reported as\n");
+    printf("\"<path>: OK\" or \"<path>: FAILED\"; --fail-fast stops at the first failure.\n");
+    printf("With --stats, per-file counters and timings (input wait, padding, compression) are written as JSON to\n");
+    printf("stderr or <file> at the end.\n");
+    printf("With --tee, stdin is copied unchanged to stdout while it is hashed, and the digest goes to stderr or\n");
+    printf("<file> as a \"<hex>  -\" line.\n");
+    printf("When stdout is redirected and stderr is a terminal, a progress bar is drawn on stderr.\n");
+}
+
+static void print_progress_bar (uint64_t progress, uint64_t bar_size, uint64_t min, uint64_t max){
+    if (min == max){
+        // total unknown (stdin), only count
+        fprintf(stderr, "\r%.1f MB hashed", (double) progress / 1e6);
+        fflush(stderr);
+        return;
+    }
+    uint32_t bar_pos = (uint32_t) (((uint64_t) bar_size * (progress - min)) / (max - min));
+    float percent = 100.0 * ((float) (progress - min) / (float)(max - min));
+
+    fputs("\r[", stderr);
+    for (unsigned int i = 0; i < bar_size; i++){
+        if (i < bar_pos){
+            fputc('=', stderr);
+        } else {
+            fputc('-', stderr);
+        }
+    }
+    if (percent > 100.0){
+        percent = 100.0;
+    }
+    fprintf(stderr, "] %.3f %%", percent);
+    fflush(stderr);
+}
+
+static void hash_job_progress (void *user, uint64_t bytes_hashed){
+    hash_job *job = (hash_job *) user;
+    uint64_t done = __atomic_add_fetch(&progress_done_bytes, bytes_hashed - job->bytes_reported, __ATOMIC_RELAXED);
+
+    job->bytes_reported = bytes_hashed;
+    if (pthread_mutex_trylock(&progress_lock) == 0){
+        print_progress_bar(done, 50, 0, progress_total_bytes);
+        pthread_mutex_unlock(&progress_lock);
+    }
+}
+
+// parses sizes like 4096, 64K, 4M or 1G, returns 0 when the text is not a size
+static uint64_t parse_size (const char *text){
+    char *end;
+    uint64_t size = strtoull(text, &end, 10);
+
+    switch (*end){
+        case 'K': case 'k': size <<= 10; end++; break;
+        case 'M': case 'm': size <<= 20; end++; break;
+        case 'G': case 'g': size <<= 30; end++; break;
+        default: break;
+    }
+    return (*end == '\0') ? size : 0;
+}
+
+// parses <min>:<avg>:<max>, each a size as accepted by parse_size
+static int parse_cdc_params (const char *text, cdc_params *params){
+    char sizes[3][32];
+    cdc_chunker check;
+
+    if (sscanf(text, "%31[^:]:%31[^:]:%31s", sizes[0], sizes[1], sizes[2]) != 3){
+        return -1;
+    }
+    params->min_size = parse_size(sizes[0]);
+    params->avg_size = parse_size(sizes[1]);
+    params->max_size = parse_size(sizes[2]);
+    return cdc_init(&check, params, NULL, NULL, NULL);
+}
+
+static uint32_t digest_size (enum hash_algorithm algorithm){
+    return (algorithm == HASH_SHA256) ? 32 : 64;
+}
+
+static void hash_state_init (hash_state *state, enum hash_algorithm algorithm){
+    state->algorithm = algorithm;
+    state->timed = 0;
+    state->update_ns = 0;
+    if (algorithm == HASH_SHA256){
+        sha256_init(&state->ctx256);
+    } else {
+        sha512_init(&state->ctx512);
+    }
+}
+
+// mapped files arrive a whole window at a time, so the input is taken in slices to notice a cancel in time
+static int hash_state_update (void *user, const uint8_t *data, uint64_t size){
+    hash_state *state = (hash_state *) user;
+    uint64_t start_ns = state->timed ? sha_now_ns() : 0;
+
+    while (size > 0){
+        uint64_t slice = (size < SHA_IO_BUFFER_SIZE) ? size : SHA_IO_BUFFER_SIZE;
+
+        if (__atomic_load_n(&hash_jobs_cancelled, __ATOMIC_RELAXED)){
+            return -1;
+        }
+        if (state->algorithm == HASH_SHA256){
+            sha256_update(&state->ctx256, data, slice);
+        } else {
+            sha512_update(&state->ctx512, data, slice);
+        }
+        data += slice;
+        size -= slice;
+    }
+    if (state->timed){
+        state->update_ns += sha_now_ns() - start_ns;
+    }
+    return 0;
+}
+
+static void hash_state_final (hash_state *state, uint8_t digest[64]){
+    if (state->algorithm == HASH_SHA256){
+        sha256_final(&state->ctx256, digest);
+    } else {
+        sha512_final(&state->ctx512, digest);
+    }
+}
+
+// both passes run over one slice while it is still in cache, so a mapped window is only pulled from memory once.
+// the chunks are hashed after every slice, or after every batch of slices when they go to the pool.
+static int hash_chunked_update (void *user, const uint8_t *data, uint64_t size){
+    hash_chunked *chunked = (hash_chunked *) user;
+    uint64_t batch = (chunked->chunker->pool != NULL) ? HASH_CHUNKED_POOL_BATCH : HASH_CHUNKED_SLICE;
+    uint64_t collected = 0;
+    int result = 0;
+
+    while (size > 0 && result == 0){
+        uint64_t slice = (size < HASH_CHUNKED_SLICE) ? size : HASH_CHUNKED_SLICE;
+
+        result = hash_state_update(chunked->state, data, slice);
+        if (result == 0){
+            result = cdc_collect(chunked->chunker, data, slice);
+        }
+        data += slice;
+        size -= slice;
+        collected += slice;
+        if (result == 0 && (collected >= batch || size == 0)){
+            result = cdc_flush(chunked->chunker);
+            collected = 0;
+        }
+    }
+    return result;
+}
+
+static int print_chunk (void *user, const cdc_record *record){
+    (void) user;
+    for (uint32_t i = 0; i < 32; i++){
+        printf("%02x", record->digest[i]);
+    }
+    printf(" %llu %llu\n", (unsigned long long) record->offset, (unsigned long long) record->length);
+    return 0;
+}
+
+// regular files are mapped and pipes are read ahead on a second thread, memory use never depends on the input size
+static int hash_file_streaming (hash_job *job){
+    hash_state state;
+    cdc_chunker chunker;
+    hash_chunked chunked = {&state, &chunker};
+    uint64_t start_ns = 0, final_ns;
+    int result;
+
+    hash_state_init(&state, job->algorithm);
+    if (job->options->stats){
+        if (job->algorithm == HASH_SHA256){
+            sha256_set_stats(&state.ctx256, &job->stats);
+        } else {
+            sha512_set_stats(&state.ctx512, &job->stats);
+        }
+        state.timed = 1;
+        start_ns = sha_now_ns();
+    }
+    if (job->options->progress){
+        if (job->algorithm == HASH_SHA256){
+            sha256_set_progress(&state.ctx256, hash_job_progress, job, 0, PROGRESS_INTERVAL_MS);
+        } else {
+            sha512_set_progress(&state.ctx512, hash_job_progress, job, 0, PROGRESS_INTERVAL_MS);
+        }
+    }
+    if (job->options->cdc){
+        cdc_init(&chunker, &job->options->cdc_params, job->options->cdc_pool, print_chunk, NULL);
+        result = sha_io_read_path(job->path, hash_chunked_update, &chunked);
+        if (result == 0){
+            result = cdc_final(&chunker);
+        }
+        cdc_free(&chunker);
+    } else {
+        result = sha_io_read_path(job->path, hash_state_update, &state);
+    }
+    if (result != 0 && __atomic_load_n(&hash_jobs_cancelled, __ATOMIC_RELAXED)){
+        job->cancelled = 1;
+        return -1;
+    }
+    if (result != 0){
+        fprintf(stderr, "Error: could not read %s: %s\n", job->path, strerror(errno));
+        return -1;
+    }
+    if (job->options->progress){
+        hash_job_progress(job, (job->algorithm == HASH_SHA256) ? state.ctx256.data_size_bytes
+                                                                         : state.ctx512.data_size_bytes);
+    }
+    final_ns = job->options->stats ? sha_now_ns() : 0;
+    hash_state_final(&state, job->digest);
+    if (job->options->stats){
+        job->hash_ns = state.update_ns + (sha_now_ns() - final_ns);
+        job->wall_ns = sha_now_ns() - start_ns;
+    }
+    return 0;
+}
+
+// the tree needs random access to every chunk, so the whole file is mapped at once
+static int hash_file_tree (const char *path, const hash_options *options, uint8_t digest[64]){
+    const uint8_t *data;
+    uint64_t size;
+    int result;
+
+    if (sha_io_map_path(path, &data, &size) != 0){
+        fprintf(stderr, "Error: could not map %s (tree mode needs a regular file)\n", path);
+        return -1;
+    }
+    if (options->algorithm == HASH_SHA256){
+        result = sha256_tree(data, size, options->chunk_size, options->num_threads, digest);
+    } else {
+        result = sha512_tree(data, size, options->chunk_size, options->num_threads, digest);
+    }
+    sha_io_unmap(data, size);
+    return result;
+}
+
+// regular files are looked up by device, inode, size and mtime first; --paranoid still hashes them but refreshes
+// the cache. tree and chunk digests are not plain file digests, so those modes do not use it.
+static void hash_job_run (void *arg){
+    hash_job *job = (hash_job *) arg;
+    const hash_options *options = job->options;
+    uint32_t size = digest_size(job->algorithm);
+    struct stat file_status;
+    int cacheable, result;
+
+    if (__atomic_load_n(&hash_jobs_cancelled, __ATOMIC_RELAXED)){
+        pthread_mutex_lock(&hash_jobs_lock);
+        job->result = -1;
+        job->cancelled = 1;
+        job->done = 1;
+        pthread_cond_broadcast(&hash_job_finished);
+        pthread_mutex_unlock(&hash_jobs_lock);
+        return;
+    }
+
+    cacheable = options->cache != NULL && !options->tree && !options->cdc && strcmp(job->path, "-") != 0 &&
+                stat(job->path, &file_status) == 0 && S_ISREG(file_status.st_mode);
+
+    if (cacheable && !options->paranoid &&
+        digest_cache_lookup(options->cache, &file_status, job->algorithm, job->digest, size) == 0){
+        if (options->progress){
+            hash_job_progress(job, (uint64_t) file_status.st_size);
+        }
+        job->cached = 1;
+        result = 0;
+    } else if (options->tree){
+        result = hash_file_tree(job->path, options, job->digest);
+    } else {
+        result = hash_file_streaming(job);
+        if (result == 0 && cacheable &&
+            digest_cache_store(options->cache, &file_status, job->algorithm, job->digest, size) != 0){
+            fprintf(stderr, "Warning: out of memory, %s is not cached\n", job->path);
+        }
+    }
+    if (result == 0 && job->expected != NULL){
+        job->mismatch = !sha_digest_equal(job->digest, job->expected, size);
+    }
+    if ((result != 0 || job->mismatch) && !job->cancelled && options->fail_fast){
+        __atomic_store_n(&hash_jobs_cancelled, 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_lock(&hash_jobs_lock);
+    job->result = result;
+    job->done = 1;
+    pthread_cond_broadcast(&hash_job_finished);
+    pthread_mutex_unlock(&hash_jobs_lock);
+}
+
+static void print_path (const char *path, int escape){
+    for (const char *p = path; *p != '\0'; p++){
+        if (escape && *p == '\\'){
+            fputs("\\\\", stdout);
+        } else if (escape && *p == '\n'){
+            fputs("\\n", stdout);
+        } else if (escape && *p == '\r'){
+            fputs("\\r", stdout);
+        } else {
+            putchar(*p);
+        }
+    }
+}
+
+// same format as sha256sum: paths with a backslash, newline or carriage return get a leading backslash and are
+// escaped, so the line still ends where manifest_load expects
+static void print_digest_line (const uint8_t *digest, uint32_t size, const char *path){
+    int escape = strpbrk(path, "\\\n\r") != NULL;
+
+    if (escape){
+        putchar('\\');
+    }
+    for (uint32_t i = 0; i < size; i++){
+        printf("%02x", digest[i]);
+    }
+    fputs("  ", stdout);
+    print_path(path, escape);
+    putchar('\n');
+}
+
+// same format as sha256sum --check
+static void print_check_line (const hash_job *job){
+    int escape = strpbrk(job->path, "\\\n\r") != NULL;
+
+    if (escape){
+        putchar('\\');
+    }
+    print_path(job->path, escape);
+    if (job->result != 0){
+        puts(": FAILED open or read");
+    } else {
+        puts(job->mismatch ? ": FAILED" : ": OK");
+    }
+}
+
+// stdin to stdout for the middle of a pipeline; the digest line must stay out of the payload
+static int hash_tee (enum hash_algorithm algorithm, const char *digest_path){
+    hash_state state;
+    uint8_t digest[64];
+    FILE *out;
+
+    hash_state_init(&state, algorithm);
+    if (sha_io_tee_fd(STDIN_FILENO, STDOUT_FILENO, hash_state_update, &state) != 0){
+        fprintf(stderr, "Error: could not pass stdin through to stdout: %s\n", strerror(errno));
+        return -1;
+    }
+    hash_state_final(&state, digest);
+
+    out = (digest_path != NULL) ? fopen(digest_path, "w") : stderr;
+    if (out == NULL){
+        fprintf(stderr, "Error: could not write %s: %s\n", digest_path, strerror(errno));
+        return -1;
+    }
+    for (uint32_t i = 0; i < digest_size(algorithm); i++){
+        fprintf(out, "%02x", digest[i]);
+    }
+    fputs("  -\n", out);
+    if (out != stderr && fclose(out) != 0){
+        fprintf(stderr, "Error: could not write %s: %s\n", digest_path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void print_json_string (FILE *out, const char *text){
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *) text; *p != '\0'; p++){
+        if (*p == '"' || *p == '\\'){
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20){
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// one set of counters, either a file's or the sum over all files. io_ns is the time spent waiting for input
+// (reading, or mapping the next window); page faults on mapped files are taken while compressing, so they show
+// up in compress_ns. other_ns is everything else inside the hash: buffering partial blocks and bookkeeping
+static void print_stats_fields (FILE *out, const sha_stats *stats, uint64_t wall_ns, uint64_t hash_ns){
+    uint64_t busy_ns = stats->pad_ns + stats->compress_ns;
+    uint64_t other_ns = (hash_ns > busy_ns) ? hash_ns - busy_ns : 0;
+
+    fprintf(out, "\"bytes\": %llu, \"blocks\": %llu, \"copied_bytes\": %llu, \"wall_ns\": %llu, \"io_ns\": %llu, "
+                 "\"pad_ns\": %llu, \"compress_ns\": %llu, \"other_ns\": %llu, \"mb_per_s\": ",
+            (unsigned long long) stats->bytes, (unsigned long long) stats->blocks, (unsigned long long) stats->copied_bytes,
+            (unsigned long long) wall_ns, (unsigned long long) (wall_ns - hash_ns), (unsigned long long) stats->pad_ns,
+            (unsigned long long) stats->compress_ns, (unsigned long long) other_ns);
+    if (wall_ns > 0){
+        fprintf(out, "%.1f", (double) stats->bytes * 1e3 / (double) wall_ns);
+    } else {
+        fputs("null", out);
+    }
+    fputs(", \"cycles_per_byte\": ", out);
+    if (stats->compress_cycles > 0 && stats->bytes > 0){
+        fprintf(out, "%.2f", (double) stats->compress_cycles / (double) stats->bytes);
+    } else {
+        fputs("null", out);
+    }
+}
+
+// per file and summed over all files; files are hashed in parallel, so the sums can exceed elapsed_ns, and
+// elapsed_mb_per_s is the throughput of the whole run
+static void print_stats_json (FILE *out, const hash_job *jobs, size_t num_jobs, uint64_t elapsed_ns){
+    sha_stats total;
+    uint64_t total_wall_ns = 0, total_hash_ns = 0;
+
+    memset(&total, 0, sizeof(total));
+    fputs("{\n  \"files\": [", out);
+    for (size_t i = 0; i < num_jobs; i++){
+        const hash_job *job = &jobs[i];
+
+        fprintf(out, "%s\n    {\"path\": ", (i > 0) ? "," : "");
+        print_json_string(out, job->path);
+        fprintf(out, ", \"algorithm\": \"%s\", \"kernel\": ", (job->algorithm == HASH_SHA256) ? "sha256" : "sha512");
+        if (job->stats.kernel != NULL){
+            print_json_string(out, job->stats.kernel);
+        } else {
+            fputs("null", out);
+        }
+        fprintf(out, ", \"ok\": %s, \"cached\": %s, ", (job->result == 0 && !job->mismatch) ? "true" : "false",
+                job->cached ? "true" : "false");
+        print_stats_fields(out, &job->stats, job->wall_ns, job->hash_ns);
+        fputc('}', out);
+
+        total.bytes += job->stats.bytes;
+        total.blocks += job->stats.blocks;
+        total.copied_bytes += job->stats.copied_bytes;
+        total.pad_ns += job->stats.pad_ns;
+        total.compress_ns += job->stats.compress_ns;
+        total.compress_cycles += job->stats.compress_cycles;
+        total_wall_ns += job->wall_ns;
+        total_hash_ns += job->hash_ns;
+    }
+    fputs("\n  ],\n  \"total\": {", out);
+    print_stats_fields(out, &total, total_wall_ns, total_hash_ns);
+    fprintf(out, ", \"elapsed_ns\": %llu, \"elapsed_mb_per_s\": %.1f}\n}\n", (unsigned long long) elapsed_ns,
+            (elapsed_ns > 0) ? (double) total.bytes * 1e3 / (double) elapsed_ns : 0.0);
+}
+
+int main (int argc, char *argv[]){
+    hash_options options = {HASH_SHA512, 0, SHA_TREE_DEFAULT_CHUNK_SIZE, 0, 1, 0,
+                            {CDC_DEFAULT_MIN_SIZE, CDC_DEFAULT_AVG_SIZE, CDC_DEFAULT_MAX_SIZE}, NULL, NULL, 0, 0, 0};
+    digest_cache cache;
+    manifest checks = {NULL, 0, 0, 0};
+    const char *cache_path = NULL, *manifest_path = NULL, *stats_path = NULL, *digest_path = NULL;
+    int tee = 0;
+    uint64_t start_ns = sha_now_ns();
+    file_list files = {NULL, 0, 0};
+    hash_job *jobs;
+    size_t num_jobs, num_mismatched = 0, num_unreadable = 0, num_skipped = 0;
+    thread_pool *pool = NULL;
+    int num_paths = 0, status = EXIT_SUCCESS;
+
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--self-test") == 0){
+            return sha_self_test(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+        } else if (strcmp(argv[i], "--help") == 0){
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (strcmp(argv[i], "--algo=sha256") == 0){
+            options.algorithm = HASH_SHA256;
+        } else if (strcmp(argv[i], "--algo=sha512") == 0){
+            options.algorithm = HASH_SHA512;
+        } else if (strcmp(argv[i], "--tree") == 0){
+            options.tree = 1;
+        } else if (strncmp(argv[i], "--chunk=", 8) == 0){
+            if ((options.chunk_size = parse_size(argv[i] + 8)) == 0){
+                fprintf(stderr, "Error: invalid chunk size %s\n", argv[i] + 8);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strncmp(argv[i], "--threads=", 10) == 0){
+            options.num_threads = (uint32_t) strtoul(argv[i] + 10, NULL, 10);
+        } else if (strcmp(argv[i], "--cdc") == 0){
+            options.cdc = 1;
+        } else if (strncmp(argv[i], "--cdc=", 6) == 0){
+            if (parse_cdc_params(argv[i] + 6, &options.cdc_params) != 0){
+                fprintf(stderr, "Error: invalid chunk sizes %s, expected <min>:<avg>:<max> with 64 <= min <= avg <= max\n", argv[i] + 6);
+                exit(EXIT_FAILURE);
+            }
+            options.cdc = 1;
+        } else if (strncmp(argv[i], "--cache=", 8) == 0){
+            cache_path = argv[i] + 8;
+        } else if (strcmp(argv[i], "--paranoid") == 0){
+            options.paranoid = 1;
+        } else if (strcmp(argv[i], "--check") == 0 || strcmp(argv[i], "-c") == 0){
+            if (i + 1 == argc){
+                fprintf(stderr, "Error: %s needs a manifest\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            manifest_path = argv[++i];
+        } else if (strncmp(argv[i], "--check=", 8) == 0){
+            manifest_path = argv[i] + 8;
+        } else if (strcmp(argv[i], "--fail-fast") == 0){
+            options.fail_fast = 1;
+        } else if (strcmp(argv[i], "--tee") == 0){
+            tee = 1;
+        } else if (strncmp(argv[i], "--digest-file=", 14) == 0){
+            digest_path = argv[i] + 14;
+        } else if (strcmp(argv[i], "--stats") == 0){
+            options.stats = 1;
+        } else if (strncmp(argv[i], "--stats=", 8) == 0){
+            options.stats = 1;
+            stats_path = argv[i] + 8;
+        } else if (strcmp(argv[i], "--no-progress") == 0){
+            options.progress = 0;
+        } else if (strncmp(argv[i], "--", 2) == 0){
+            fprintf(stderr, "Error: unknown option %s\n", argv[i]);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        } else {
+            if (file_list_add_path(&files, argv[i]) != 0){
+                fprintf(stderr, "Error: out of memory while listing %s\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            num_paths++;
+        }
+    }
+
+    if (tee){
+        if (num_paths > 0 || options.tree || options.cdc || options.stats || manifest_path != NULL || cache_path != NULL){
+            fprintf(stderr, "Error: --tee only reads stdin and cannot be combined with other modes\n");
+            exit(EXIT_FAILURE);
+        }
+        return (hash_tee(options.algorithm, digest_path) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (digest_path != NULL){
+        fprintf(stderr, "Error: --digest-file needs --tee\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options.stats && (options.tree || options.cdc)){
+        fprintf(stderr, "Error: --stats cannot be combined with --tree or --cdc\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // a manifest brings its own paths and algorithms, one per line
+    if (manifest_path != NULL){
+        if (num_paths > 0 || options.tree || options.cdc){
+            fprintf(stderr, "Error: --check takes no paths and cannot be combined with --tree or --cdc\n");
+            exit(EXIT_FAILURE);
+        }
+        if (manifest_load(&checks, manifest_path) != 0){
+            fprintf(stderr, "Error: could not read %s: %s\n", manifest_path, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        if (checks.count == 0){
+            fprintf(stderr, "Error: no checksum lines found in %s\n", manifest_path);
+            exit(EXIT_FAILURE);
+        }
+    } else if (num_paths == 0){
+        // like sha256sum, no paths means stdin
+        file_list_add_path(&files, "-");
+    }
+
+    num_jobs = (manifest_path != NULL) ? checks.count : files.count;
+    jobs = (hash_job *) calloc(num_jobs ? num_jobs : 1, sizeof(hash_job));
+    if (jobs == NULL){
+        fprintf(stderr, "Error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < num_jobs; i++){
+        jobs[i].options = &options;
+        if (manifest_path != NULL){
+            jobs[i].path = checks.entries[i].path;
+            jobs[i].algorithm = (checks.entries[i].digest_size == 32) ? HASH_SHA256 : HASH_SHA512;
+            jobs[i].expected = checks.entries[i].digest;
+        } else {
+            jobs[i].path = files.paths[i];
+            jobs[i].algorithm = options.algorithm;
+        }
+    }
+
+    if (cache_path != NULL){
+        if (digest_cache_open(&cache, cache_path) != 0){
+            fprintf(stderr, "Error: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        options.cache = &cache;
+    }
+
+    // the bar would get mixed into the digests when both go to the terminal, and into logs when stderr is a file
+    options.progress = options.progress && !options.tree && !isatty(STDOUT_FILENO) && isatty(STDERR_FILENO);
+    if (options.progress){
+        struct stat file_status;
+        for (size_t i = 0; i < num_jobs; i++){
+            if (stat(jobs[i].path, &file_status) == 0 && S_ISREG(file_status.st_mode)){
+                progress_total_bytes += (uint64_t) file_status.st_size;
+            }
+        }
+    }
+
+    // tree mode already spreads each file over all threads, so files are taken one at a time there; with --cdc
+    // the chunk lines of a file must not mix with another's, so the threads hash chunks of one file instead
+    options.progress = options.progress && !options.cdc;
+    if (options.cdc && options.num_threads != 1){
+        options.cdc_pool = thread_pool_create(options.num_threads);
+    } else if (!options.tree && !options.cdc && num_jobs > 1 && options.num_threads != 1){
+        pool = thread_pool_create(options.num_threads);
+    }
+    if (pool != NULL){
+        for (size_t i = 0; i < num_jobs; i++){
+            thread_pool_submit(pool, hash_job_run, &jobs[i]);
+        }
+    }
+
+    // results are printed in argument order as soon as every file before them is done
+    for (size_t i = 0; i < num_jobs; i++){
+        if (pool == NULL){
+            hash_job_run(&jobs[i]);
+        }
+        pthread_mutex_lock(&hash_jobs_lock);
+        while (!jobs[i].done){
+            pthread_cond_wait(&hash_job_finished, &hash_jobs_lock);
+        }
+        pthread_mutex_unlock(&hash_jobs_lock);
+
+        if (jobs[i].cancelled){
+            status = EXIT_FAILURE;
+            num_skipped++;
+            continue;
+        }
+        if (manifest_path != NULL){
+            print_check_line(&jobs[i]);
+            fflush(stdout);
+            num_unreadable += jobs[i].result != 0;
+            num_mismatched += jobs[i].result == 0 && jobs[i].mismatch;
+            if (jobs[i].result != 0 || jobs[i].mismatch){
+                status = EXIT_FAILURE;
+            }
+            continue;
+        }
+        if (jobs[i].result != 0){
+            status = EXIT_FAILURE;
+            continue;
+        }
+        print_digest_line(jobs[i].digest, digest_size(options.algorithm), jobs[i].path);
+        fflush(stdout);
+    }
+    if (num_unreadable > 0){
+        fprintf(stderr, "Warning: %zu listed file%s could not be read\n", num_unreadable, (num_unreadable == 1) ? "" : "s");
+    }
+    if (num_mismatched > 0){
+        fprintf(stderr, "Warning: %zu computed checksum%s did not match\n", num_mismatched, (num_mismatched == 1) ? "" : "s");
+    }
+    if (num_skipped > 0){
+        fprintf(stderr, "Warning: stopped after the first failure, %zu file%s not checked\n", num_skipped,
+                (num_skipped == 1) ? " was" : "s were");
+    }
+
+    if (options.progress){
+        print_progress_bar(progress_done_bytes, 50, 0, progress_total_bytes);
+        fputc('\n', stderr);
+    }
+    if (pool != NULL){
+        thread_pool_destroy(pool);
+    }
+    if (options.stats){
+        FILE *out = (stats_path != NULL) ? fopen(stats_path, "w") : stderr;
+        if (out == NULL){
+            fprintf(stderr, "Error: could not write %s: %s\n", stats_path, strerror(errno));
+            status = EXIT_FAILURE;
+        } else {
+            print_stats_json(out, jobs, num_jobs, sha_now_ns() - start_ns);
+            if (out != stderr){
+                fclose(out);
+            }
+        }
+    }
+    if (options.cache != NULL){
+        if (digest_cache_save(options.cache) != 0){
+            fprintf(stderr, "Warning: could not update the cache %s: %s\n", cache_path, strerror(errno));
+        }
+        digest_cache_close(options.cache);
+    }
+    if (options.cdc_pool != NULL){
+        thread_pool_destroy(options.cdc_pool);
+    }
+    free(jobs);
+    file_list_free(&files);
+    manifest_free(&checks);
+    return status;
 }
\ No newline at end of file
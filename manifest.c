@@ -0,0 +1,132 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "manifest.h"
+
+static int manifest_hex_value (char c){
+    if (c >= '0' && c <= '9'){
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f'){
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F'){
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// undoes the escaping of sha256sum in place, returns -1 on an escape it never writes
+static int manifest_unescape (char *path){
+    char *out = path;
+
+    for (char *p = path; *p != '\0'; p++){
+        if (*p != '\\'){
+            *out++ = *p;
+        } else if (p[1] == '\\'){
+            *out++ = '\\';
+            p++;
+        } else if (p[1] == 'n'){
+            *out++ = '\n';
+            p++;
+        } else if (p[1] == 'r'){
+            *out++ = '\r';
+            p++;
+        } else {
+            return -1;
+        }
+    }
+    *out = '\0';
+    return 0;
+}
+
+// parses one line without its newline into entry, the path still points into line
+static int manifest_parse_line (char *line, manifest_entry *entry){
+    int escaped = line[0] == '\\';
+    size_t hex_len = 0;
+
+    line += escaped;
+    while (manifest_hex_value(line[hex_len]) >= 0){
+        hex_len++;
+    }
+    if ((hex_len != 64 && hex_len != 128) || line[hex_len] != ' ' || (line[hex_len + 1] != ' ' && line[hex_len + 1] != '*') ||
+        line[hex_len + 2] == '\0'){
+        return -1;
+    }
+    entry->digest_size = (uint32_t) (hex_len / 2);
+    for (uint32_t i = 0; i < entry->digest_size; i++){
+        entry->digest[i] = (uint8_t) (manifest_hex_value(line[2 * i]) << 4 | manifest_hex_value(line[2 * i + 1]));
+    }
+    entry->path = line + hex_len + 2;
+    return escaped ? manifest_unescape(entry->path) : 0;
+}
+
+// "-" reads stdin. lines that are not checksum lines are counted in bad_lines and reported, blank lines and
+// comments are skipped. returns -1 when the manifest cannot be read or memory runs out.
+int manifest_load (manifest *list, const char *path){
+    FILE *file = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    char *line = NULL;
+    size_t line_capacity = 0, line_number = 0;
+    ssize_t line_len;
+    int result = 0;
+
+    memset(list, 0, sizeof(*list));
+    if (file == NULL){
+        return -1;
+    }
+    while ((line_len = getline(&line, &line_capacity, file)) >= 0){
+        manifest_entry entry;
+
+        line_number++;
+        // one newline, and one \r before it for manifests written on windows; a path may end in either otherwise
+        if (line_len > 0 && line[line_len - 1] == '\n'){
+            line[--line_len] = '\0';
+        }
+        if (line_len > 0 && line[line_len - 1] == '\r'){
+            line[--line_len] = '\0';
+        }
+        if (line_len == 0 || line[0] == '#'){
+            continue;
+        }
+        if (manifest_parse_line(line, &entry) != 0){
+            fprintf(stderr, "Warning: %s:%zu: not a checksum line\n", path, line_number);
+            list->bad_lines++;
+            continue;
+        }
+
+        if (list->count == list->capacity){
+            size_t capacity = list->capacity ? 2 * list->capacity : 64;
+            manifest_entry *entries = (manifest_entry *) realloc(list->entries, capacity * sizeof(manifest_entry));
+            if (entries == NULL){
+                result = -1;
+                break;
+            }
+            list->entries = entries;
+            list->capacity = capacity;
+        }
+        if ((entry.path = strdup(entry.path)) == NULL){
+            result = -1;
+            break;
+        }
+        list->entries[list->count++] = entry;
+    }
+    if (ferror(file)){
+        result = -1;
+    }
+    free(line);
+    if (file != stdin){
+        fclose(file);
+    }
+    return result;
+}
+
+void manifest_free (manifest *list){
+    for (size_t i = 0; i < list->count; i++){
+        free(list->entries[i].path);
+    }
+    free(list->entries);
+    list->entries = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
\ No newline at end of file
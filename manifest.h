@@ -0,0 +1,31 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+#include <stdint.h>
+#include <stddef.h>
+
+// Checksum manifests as written by sha256sum and sha512sum.
+//
+// every line is "<hex>  <path>" (or "<hex> *<path>" for binary mode), a line starting with a backslash has its
+// path escaped with \\, \n and \r. the algorithm of each entry follows from the length of its hex digest, so one
+// manifest may mix both.
+
+typedef struct manifest_entry {
+    char *path;
+    uint32_t digest_size;
+    uint8_t digest[64];
+} manifest_entry;
+
+typedef struct manifest {
+    manifest_entry *entries;
+    size_t count;
+    size_t capacity;
+    size_t bad_lines;
+} manifest;
+
+#include "manifest.c"
+
+int manifest_load (manifest *list, const char *path);
+
+void manifest_free (manifest *list);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "pbkdf2.h"
+#include "hmac.h"
+#include "sha_batch.h"
+#include "sha_helpers.h"
+
+// RFC 8018 caps the output at (2^32 - 1) blocks
+static int pbkdf2_arguments_valid (uint32_t iterations, size_t out_size_bytes, uint32_t digest_size){
+    return iterations > 0 && (uint64_t) out_size_bytes <= 0xffffffffULL * digest_size;
+}
+
+// sets up one output block: keys the password, computes U_1 = HMAC(salt || INT(index)) with the streaming hmac
+// and pads u for the fixed 32 byte messages of the later iterations
+static void pbkdf2_sha256_lane_start (pbkdf2_sha256_lane *lane, const uint8_t *password, size_t password_size_bytes,
+                                      const uint8_t *salt, size_t salt_size_bytes, uint32_t index){
+    hmac_sha256_ctx ctx;
+    uint8_t counter[4];
+
+    hmac_sha256_set_key(&lane->key, password, password_size_bytes);
+    store_be32(counter, index);
+    hmac_sha256_init(&ctx, &lane->key);
+    hmac_sha256_update(&ctx, salt, salt_size_bytes);
+    hmac_sha256_update(&ctx, counter, 4);
+    hmac_sha256_final(&ctx, lane->u);
+
+    for (uint32_t i = 0; i < 8; i++){
+        lane->t[i] = load_be32(lane->u + 4 * i);
+    }
+    memset(lane->u + 32, 0x0, 32);
+    lane->u[32] = 0x80;
+    store_be64(lane->u + 56, (64 + 32) * 8);
+}
+
+// the remaining iterations of one block, one inner and one outer compression each
+static void pbkdf2_sha256_lane_run (pbkdf2_sha256_lane *lane, uint32_t iterations){
+    uint32_t hash[8];
+
+    for (uint32_t j = 1; j < iterations; j++){
+        memcpy(hash, lane->key.inner, sizeof(hash));
+        sha256_compress_blocks(hash, lane->u, 1);
+        for (uint32_t i = 0; i < 8; i++){
+            store_be32(lane->u + 4 * i, hash[i]);
+        }
+        memcpy(hash, lane->key.outer, sizeof(hash));
+        sha256_compress_blocks(hash, lane->u, 1);
+        for (uint32_t i = 0; i < 8; i++){
+            store_be32(lane->u + 4 * i, hash[i]);
+            lane->t[i] ^= hash[i];
+        }
+    }
+    sha_wipe(hash, sizeof(hash));
+}
+
+// the same iterations for up to one lane group at once: every lane has its own key and its own u, and the lanes
+// past count compress an idle block whose result is ignored
+static void pbkdf2_sha256_lanes_run (pbkdf2_sha256_lane *lane, uint32_t count, uint32_t lanes, sha256_lanes_fn compress,
+                                     uint32_t iterations){
+    uint32_t state[8][SHA_BATCH_MAX_LANES] = {{0}};
+    const uint8_t *blocks[SHA_BATCH_MAX_LANES];
+
+    for (uint32_t l = 0; l < lanes; l++){
+        blocks[l] = (l < count) ? lane[l].u : SHA_BATCH_IDLE_BLOCK;
+    }
+    for (uint32_t j = 1; j < iterations; j++){
+        for (uint32_t l = 0; l < count; l++){
+            for (uint32_t i = 0; i < 8; i++){
+                state[i][l] = lane[l].key.inner[i];
+            }
+        }
+        compress(state, blocks);
+        for (uint32_t l = 0; l < count; l++){
+            for (uint32_t i = 0; i < 8; i++){
+                store_be32(lane[l].u + 4 * i, state[i][l]);
+                state[i][l] = lane[l].key.outer[i];
+            }
+        }
+        compress(state, blocks);
+        for (uint32_t l = 0; l < count; l++){
+            for (uint32_t i = 0; i < 8; i++){
+                store_be32(lane[l].u + 4 * i, state[i][l]);
+                lane[l].t[i] ^= state[i][l];
+            }
+        }
+    }
+    sha_wipe(state, sizeof(state));
+}
+
+static void pbkdf2_sha256_lane_output (const pbkdf2_sha256_lane *lane, uint8_t *out, size_t out_size_bytes){
+    uint8_t block[32];
+
+    for (uint32_t i = 0; i < 8; i++){
+        store_be32(block + 4 * i, lane->t[i]);
+    }
+    memcpy(out, block, (out_size_bytes < 32) ? out_size_bytes : 32);
+    sha_wipe(block, sizeof(block));
+}
+
+// returns -1 for zero iterations or an output longer than the standard allows
+int pbkdf2_sha256(const uint8_t *password, size_t password_size_bytes, const uint8_t *salt, size_t salt_size_bytes,
+                  uint32_t iterations, uint8_t *out, size_t out_size_bytes){
+    pbkdf2_sha256_lane lane;
+
+    if (!pbkdf2_arguments_valid(iterations, out_size_bytes, 32)){
+        return -1;
+    }
+    for (size_t offset = 0; offset < out_size_bytes; offset += 32){
+        pbkdf2_sha256_lane_start(&lane, password, password_size_bytes, salt, salt_size_bytes, (uint32_t) (offset / 32 + 1));
+        pbkdf2_sha256_lane_run(&lane, iterations);
+        pbkdf2_sha256_lane_output(&lane, out + offset, out_size_bytes - offset);
+    }
+    // the lane holds the keyed midstates and the running U and T blocks
+    sha_wipe(&lane, sizeof(lane));
+    return 0;
+}
+
+// derives out[i] from passwords[i] and salts[i], all with the same iteration count and output size. every output
+// block of every password is one lane, so a single long output also fills the lanes.
+int pbkdf2_sha256_batch(const uint8_t **passwords, const size_t *password_lens, const uint8_t **salts,
+                        const size_t *salt_lens, size_t n, uint32_t iterations, uint8_t **out, size_t out_size_bytes){
+    pbkdf2_sha256_lane lane[SHA_BATCH_MAX_LANES];
+    sha256_lanes_fn compress;
+    uint32_t lanes = sha256_batch_lane_kernel(&compress);
+    uint64_t blocks_per_password = ceil_divide(out_size_bytes, 32);
+    uint64_t jobs = n * blocks_per_password;
+
+    if (!pbkdf2_arguments_valid(iterations, out_size_bytes, 32)){
+        return -1;
+    }
+    if (lanes == 0){
+        for (size_t i = 0; i < n; i++){
+            pbkdf2_sha256(passwords[i], password_lens[i], salts[i], salt_lens[i], iterations, out[i], out_size_bytes);
+        }
+        return 0;
+    }
+
+    for (uint64_t first = 0; first < jobs; first += lanes){
+        uint32_t count = (jobs - first < lanes) ? (uint32_t) (jobs - first) : lanes;
+
+        for (uint32_t l = 0; l < count; l++){
+            size_t password = (size_t) ((first + l) / blocks_per_password);
+            uint32_t block = (uint32_t) ((first + l) % blocks_per_password);
+            pbkdf2_sha256_lane_start(&lane[l], passwords[password], password_lens[password], salts[password],
+                                     salt_lens[password], block + 1);
+        }
+        pbkdf2_sha256_lanes_run(lane, count, lanes, compress, iterations);
+        for (uint32_t l = 0; l < count; l++){
+            size_t password = (size_t) ((first + l) / blocks_per_password);
+            size_t offset = (size_t) ((first + l) % blocks_per_password) * 32;
+            pbkdf2_sha256_lane_output(&lane[l], out[password] + offset, out_size_bytes - offset);
+        }
+    }
+    sha_wipe(lane, sizeof(lane));
+    return 0;
+}
+
+//****************************************************************************************************************
+
+static void pbkdf2_sha512_lane_start (pbkdf2_sha512_lane *lane, const uint8_t *password, size_t password_size_bytes,
+                                      const uint8_t *salt, size_t salt_size_bytes, uint32_t index){
+    hmac_sha512_ctx ctx;
+    uint8_t counter[4];
+
+    hmac_sha512_set_key(&lane->key, password, password_size_bytes);
+    store_be32(counter, index);
+    hmac_sha512_init(&ctx, &lane->key);
+    hmac_sha512_update(&ctx, salt, salt_size_bytes);
+    hmac_sha512_update(&ctx, counter, 4);
+    hmac_sha512_final(&ctx, lane->u);
+
+    for (uint32_t i = 0; i < 8; i++){
+        lane->t[i] = load_be64(lane->u + 8 * i);
+    }
+    memset(lane->u + 64, 0x0, 64);
+    lane->u[64] = 0x80;
+    store_be64(lane->u + 120, (128 + 64) * 8);
+}
+
+static void pbkdf2_sha512_lane_run (pbkdf2_sha512_lane *lane, uint32_t iterations){
+    uint64_t hash[8];
+
+    for (uint32_t j = 1; j < iterations; j++){
+        memcpy(hash, lane->key.inner, sizeof(hash));
+        sha512_compress_blocks(hash, lane->u, 1);
+        for (uint32_t i = 0; i < 8; i++){
+            store_be64(lane->u + 8 * i, hash[i]);
+        }
+        memcpy(hash, lane->key.outer, sizeof(hash));
+        sha512_compress_blocks(hash, lane->u, 1);
+        for (uint32_t i = 0; i < 8; i++){
+            store_be64(lane->u + 8 * i, hash[i]);
+            lane->t[i] ^= hash[i];
+        }
+    }
+    sha_wipe(hash, sizeof(hash));
+}
+
+static void pbkdf2_sha512_lanes_run (pbkdf2_sha512_lane *lane, uint32_t count, uint32_t lanes, sha512_lanes_fn compress,
+                                     uint32_t iterations){
+    uint64_t state[8][SHA_BATCH_MAX_LANES] = {{0}};
+    const uint8_t *blocks[SHA_BATCH_MAX_LANES];
+
+    for (uint32_t l = 0; l < lanes; l++){
+        blocks[l] = (l < count) ? lane[l].u : SHA_BATCH_IDLE_BLOCK;
+    }
+    for (uint32_t j = 1; j < iterations; j++){
+        for (uint32_t l = 0; l < count; l++){
+            for (uint32_t i = 0; i < 8; i++){
+                state[i][l] = lane[l].key.inner[i];
+            }
+        }
+        compress(state, blocks);
+        for (uint32_t l = 0; l < count; l++){
+            for (uint32_t i = 0; i < 8; i++){
+                store_be64(lane[l].u + 8 * i, state[i][l]);
+                state[i][l] = lane[l].key.outer[i];
+            }
+        }
+        compress(state, blocks);
+        for (uint32_t l = 0; l < count; l++){
+            for (uint32_t i = 0; i < 8; i++){
+                store_be64(lane[l].u + 8 * i, state[i][l]);
+                lane[l].t[i] ^= state[i][l];
+            }
+        }
+    }
+    sha_wipe(state, sizeof(state));
+}
+
+static void pbkdf2_sha512_lane_output (const pbkdf2_sha512_lane *lane, uint8_t *out, size_t out_size_bytes){
+    uint8_t block[64];
+
+    for (uint32_t i = 0; i < 8; i++){
+        store_be64(block + 8 * i, lane->t[i]);
+    }
+    memcpy(out, block, (out_size_bytes < 64) ? out_size_bytes : 64);
+    sha_wipe(block, sizeof(block));
+}
+
+int pbkdf2_sha512(const uint8_t *password, size_t password_size_bytes, const uint8_t *salt, size_t salt_size_bytes,
+                  uint32_t iterations, uint8_t *out, size_t out_size_bytes){
+    pbkdf2_sha512_lane lane;
+
+    if (!pbkdf2_arguments_valid(iterations, out_size_bytes, 64)){
+        return -1;
+    }
+    for (size_t offset = 0; offset < out_size_bytes; offset += 64){
+        pbkdf2_sha512_lane_start(&lane, password, password_size_bytes, salt, salt_size_bytes, (uint32_t) (offset / 64 + 1));
+        pbkdf2_sha512_lane_run(&lane, iterations);
+        pbkdf2_sha512_lane_output(&lane, out + offset, out_size_bytes - offset);
+    }
+    // the lane holds the keyed midstates and the running U and T blocks
+    sha_wipe(&lane, sizeof(lane));
+    return 0;
+}
+
+int pbkdf2_sha512_batch(const uint8_t **passwords, const size_t *password_lens, const uint8_t **salts,
+                        const size_t *salt_lens, size_t n, uint32_t iterations, uint8_t **out, size_t out_size_bytes){
+    pbkdf2_sha512_lane lane[SHA_BATCH_MAX_LANES];
+    sha512_lanes_fn compress;
+    uint32_t lanes = sha512_batch_lane_kernel(&compress);
+    uint64_t blocks_per_password = ceil_divide(out_size_bytes, 64);
+    uint64_t jobs = n * blocks_per_password;
+
+    if (!pbkdf2_arguments_valid(iterations, out_size_bytes, 64)){
+        return -1;
+    }
+    if (lanes == 0){
+        for (size_t i = 0; i < n; i++){
+            pbkdf2_sha512(passwords[i], password_lens[i], salts[i], salt_lens[i], iterations, out[i], out_size_bytes);
+        }
+        return 0;
+    }
+
+    for (uint64_t first = 0; first < jobs; first += lanes){
+        uint32_t count = (jobs - first < lanes) ? (uint32_t) (jobs - first) : lanes;
+
+        for (uint32_t l = 0; l < count; l++){
+            size_t password = (size_t) ((first + l) / blocks_per_password);
+            uint32_t block = (uint32_t) ((first + l) % blocks_per_password);
+            pbkdf2_sha512_lane_start(&lane[l], passwords[password], password_lens[password], salts[password],
+                                     salt_lens[password], block + 1);
+        }
+        pbkdf2_sha512_lanes_run(lane, count, lanes, compress, iterations);
+        for (uint32_t l = 0; l < count; l++){
+            size_t password = (size_t) ((first + l) / blocks_per_password);
+            size_t offset = (size_t) ((first + l) % blocks_per_password) * 64;
+            pbkdf2_sha512_lane_output(&lane[l], out[password] + offset, out_size_bytes - offset);
+        }
+    }
+    sha_wipe(lane, sizeof(lane));
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef PBKDF2_H
+#define PBKDF2_H
+#include <stdint.h>
+#include <stddef.h>
+#include "hmac.h"
+#include "sha_batch.h"
+
+// PBKDF2 (RFC 8018) with HMAC-SHA256 and HMAC-SHA512.
+//
+// the password is keyed once into hmac midstates; after the first iteration every U_j = HMAC(U_j-1) is two
+// single block compressions over a buffer whose padding never changes, so the iteration loop does not allocate.
+
+// one output block being derived: its key, the current U followed by the fixed padding, and the running xor
+typedef struct pbkdf2_sha256_lane {
+    hmac_sha256_key key;
+    uint8_t u[64];
+    uint32_t t[8];
+} pbkdf2_sha256_lane;
+
+typedef struct pbkdf2_sha512_lane {
+    hmac_sha512_key key;
+    uint8_t u[128];
+    uint64_t t[8];
+} pbkdf2_sha512_lane;
+
+#include "pbkdf2.c"
+
+int pbkdf2_sha256(const uint8_t *password, size_t password_size_bytes, const uint8_t *salt, size_t salt_size_bytes,
+                  uint32_t iterations, uint8_t *out, size_t out_size_bytes);
+
+int pbkdf2_sha512(const uint8_t *password, size_t password_size_bytes, const uint8_t *salt, size_t salt_size_bytes,
+                  uint32_t iterations, uint8_t *out, size_t out_size_bytes);
+
+int pbkdf2_sha256_batch(const uint8_t **passwords, const size_t *password_lens, const uint8_t **salts,
+                        const size_t *salt_lens, size_t n, uint32_t iterations, uint8_t **out, size_t out_size_bytes);
+
+int pbkdf2_sha512_batch(const uint8_t **passwords, const size_t *password_lens, const uint8_t **salts,
+                        const size_t *salt_lens, size_t n, uint32_t iterations, uint8_t **out, size_t out_size_bytes);
+
+#endif
\ No newline at end of file
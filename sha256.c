@@ -1,202 +1,447 @@
-#include <stdint.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include "sha256.h"
-#include "sha_helpers.h"
-
-//****************************************************************************************************************
-
-// these represent the bits of the decimal value multiplied by 2^32, of the square roots of the first 8 primes. 
-static const uint32_t SHA256_INITIAL_HASH_VAL[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
-						                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
-
-// these represent the bits of the cube roots of the first 64 prime numbers.
-static const uint32_t SHA256_K_CONSTANTS[64] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 
-                                         0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-                                         0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-                                         0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-                                         0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-                                         0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-                                         0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-                                         0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-                                         0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-                                         0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-                                         0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-                                         0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-                                         0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-                                         0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-                                         0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-                                         0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
-
-//****************************************************************************************************************
-
-static uint32_t SHA256_sigma_1 (uint32_t val){
-    uint32_t rotate_right_17 = (val >> 17) | (val << 15);
-    uint32_t rotate_right_19 = (val >> 19) | (val << 13);
-    uint32_t shift_right_10 = val >> 10;
-
-    return rotate_right_17 ^ rotate_right_19 ^ shift_right_10;
-}
-
-static uint32_t SHA256_sigma_0 (uint32_t val){
-    uint32_t rotate_right_7 = (val >> 7) | (val << 25);
-    uint32_t rotate_right_18 = (val >> 18) | (val << 14);
-    uint32_t shift_right_3 = val >> 3;
-
-    return rotate_right_7 ^ rotate_right_18 ^ shift_right_3;
-}
-
-static uint32_t SHA256_big_sigma_1 (uint32_t val){
-    uint32_t rotate_right_6 = (val >> 6) | (val << 26);
-    uint32_t rotate_right_11 = (val >> 11) | (val << 21);
-    uint32_t rotate_right_25 = (val >> 25) | (val << 7);
-
-    return rotate_right_6 ^ rotate_right_11 ^ rotate_right_25;
-}
-
-static uint32_t SHA256_big_sigma_0 (uint32_t val){
-    uint32_t rotate_right_2 = (val >> 2) | (val << 30);
-    uint32_t rotate_right_13 = (val >> 13) | (val << 19);
-    uint32_t rotate_right_22 = (val >> 22) | (val << 10);
-
-    return rotate_right_2 ^ rotate_right_13 ^ rotate_right_22;
-}
-
-uint8_t *sha256(uint8_t *data, uint64_t data_size_bytes){
-    uint64_t data_size_bits;
-    uint32_t num_of_blocks;
-    uint8_t **data_blocks;
-
-    uint32_t message_schedule[64] = {0};
-
-    uint32_t hash[8], temp_hash[8], temp1, temp2;
-    uint8_t *digest;
-
-    data_size_bits = data_size_bytes * 8;
-    num_of_blocks = ceil_divide(data_size_bytes, 64);
-
-    printf("Allocating %lu bytes in memory (%lu blocks)...\n" , data_size_bytes, num_of_blocks);
-    data_blocks = (uint8_t **) malloc(num_of_blocks * sizeof(uint8_t *));
-    for (uint32_t i = 0; i < num_of_blocks; i++){
-        data_blocks[i] = (uint8_t *) malloc(64 * sizeof(uint8_t));
-    }
-
-    printf("Pre-processing blocks...\n");
-    for (uint32_t block = 0; block < num_of_blocks; block++){
-        if (block == num_of_blocks - 1){
-            uint32_t len = data_size_bytes % 64;
-            for (uint32_t byte = 0; byte < len; byte++){
-                data_blocks[block][byte] = data[(block * 64) + byte];
-            }
-            data_blocks[block][len] = 0x80;
- 
-            for (uint32_t byte = len + 1; byte < 56; byte++){
-                data_blocks[block][byte] = 0x0;
-            }
-            // intialize the last 8 bytes to be the length of the message 
-            data_blocks[block][56] = (data_size_bits >> 56) & 0x00000000000000FF;
-            data_blocks[block][57] = (data_size_bits >> 48) & 0x00000000000000FF;
-            data_blocks[block][58] = (data_size_bits >> 40) & 0x00000000000000FF;
-            data_blocks[block][59] = (data_size_bits >> 32) & 0x00000000000000FF;
-            data_blocks[block][60] = (data_size_bits >> 24) & 0x00000000000000FF;
-            data_blocks[block][61] = (data_size_bits >> 16) & 0x00000000000000FF;
-            data_blocks[block][62] = (data_size_bits >> 8) & 0x00000000000000FF;
-            data_blocks[block][63] = data_size_bits & 0x00000000000000FF;
-        } else {
-            for (uint32_t byte = 0; byte < 64; byte++){
-                data_blocks[block][byte] = data[(block * 64) + byte]; // make 2D array from 1D array
-            }
-        }
-        if (num_of_blocks > 10000){
-            if ((block % 500) == 0 || (block == num_of_blocks - 1)){
-                print_progress_bar((uint64_t) block, 50, 0, (uint64_t) (num_of_blocks - 1));
-            }
-        } else {
-            print_progress_bar((uint64_t) block, 50, 0, (uint64_t) (num_of_blocks - 1));
-        }  
-    }
-        printf("\nFilling hash register...\n");
-    for (uint8_t i = 0; i < 8; i++){
-        hash[i] = SHA256_INITIAL_HASH_VAL[i];
-        if (i % 2 || i == 7){
-            print_progress_bar((uint64_t) i, 50, 0, 7);
-        }
-    }
-
-    printf("\nHashing Data...\n");
-    for (uint32_t block = 0; block < num_of_blocks; block++){
-        for (uint8_t byte = 0; byte < 64; byte += 4){
-            message_schedule[byte / 4] = (((uint32_t) data_blocks[block][byte]) << 24)     |
-                                         (((uint32_t) data_blocks[block][byte + 1]) << 16) |
-                                         (((uint32_t) data_blocks[block][byte + 2]) << 8)  |
-                                         ((uint32_t) data_blocks[block][byte + 3]);
-        }
-    
-        temp_hash[a] = hash[0];
-        temp_hash[b] = hash[1];
-        temp_hash[c] = hash[2];
-        temp_hash[d] = hash[3];
-        temp_hash[e] = hash[4];
-        temp_hash[f] = hash[5];
-        temp_hash[g] = hash[6];
-        temp_hash[h] = hash[7];
-
-        for (uint32_t i = 16; i < 64; i++){
-            message_schedule[i] = SHA256_sigma_1(message_schedule[i - 2]) + message_schedule[i - 7] 
-                                + SHA256_sigma_0(message_schedule[i - 15]) + message_schedule[i - 16];
-        }
-
-        for (uint32_t i = 0; i < 64; i++){
-            temp1 = SHA256_big_sigma_1(temp_hash[e]) + choice(temp_hash[e], temp_hash[f], temp_hash[g]) + 
-                                SHA256_K_CONSTANTS[i] + message_schedule[i] + temp_hash[h];
-            temp1 = SHA256_big_sigma_0(temp_hash[a]) + majority(temp_hash[a], temp_hash[b], temp_hash[c]);
-
-            temp_hash[h] = hash[g];
-            temp_hash[g] = hash[f];
-            temp_hash[f] = hash[e];
-            temp_hash[e] = hash[d]; + temp1;
-            temp_hash[d] = hash[c];
-            temp_hash[c] = hash[b];
-            temp_hash[b] = hash[a];
-            temp_hash[a] = temp1 + temp2;
-        }
-        hash[0] += temp_hash[a];
-        hash[1] += temp_hash[b];
-        hash[2] += temp_hash[c];
-        hash[3] += temp_hash[d];
-        hash[4] += temp_hash[e];
-        hash[5] += temp_hash[f];
-        hash[6] += temp_hash[g];
-        hash[7] += temp_hash[h];
-
-        if (num_of_blocks > 10000){
-            if ((block % 1000) == 0 || (block == num_of_blocks - 1)){
-                print_progress_bar((uint64_t) block, 50, 0, (uint64_t) (num_of_blocks - 1));
-            }
-        } else {
-            print_progress_bar((uint64_t) block, 50, 0, (uint64_t) (num_of_blocks - 1));
-        } 
-    }
-    printf("\nReturning blocks to the heap...\n");
-    for (uint32_t i = 0; i < num_of_blocks; i++){
-        free(data_blocks[i]);
-        if (num_of_blocks > 1001){
-            if ((i % 100) == 0){
-                print_progress_bar((uint64_t) i, 50, 0, (uint64_t) (num_of_blocks - 1));
-            }
-        } else {
-            print_progress_bar((uint64_t) i, 50, 0, (uint64_t) (num_of_blocks - 1));
-        }
-    }
-    free(data_blocks);
-    
-    digest = (uint8_t *) malloc(32 * sizeof(uint8_t));
-
-    for (uint32_t i = 0; i < 32; i += 4){
-        digest[i] = (uint8_t) ((hash[i / 4] >> 25 & 0x000000FF)); 
-        digest[i + 1] = (uint8_t) ((hash[i / 4] >> 16 & 0x000000FF));
-        digest[i + 2] = (uint8_t) ((hash[i / 4] >> 8 & 0x000000FF));
-        digest[i + 3] = (uint8_t) ((hash[i / 4] & 0x000000FF));
-    }
-    return digest;
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "sha256.h"
+#include "sha_helpers.h"
+#include "sha_cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+//****************************************************************************************************************
+
+// these represent the bits of the decimal value multiplied by 2^32, of the square roots of the first 8 primes. 
+static const uint32_t SHA256_INITIAL_HASH_VAL[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+						                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+// these represent the bits of the cube roots of the first 64 prime numbers.
+static const uint32_t SHA256_K_CONSTANTS[64] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 
+                                         0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                                         0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+                                         0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                                         0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+                                         0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                                         0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+                                         0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                                         0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+                                         0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                                         0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+                                         0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                                         0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+                                         0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                                         0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+                                         0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+//****************************************************************************************************************
+
+static inline uint32_t SHA256_sigma_1 (uint32_t val){
+    return rotr32(val, 17) ^ rotr32(val, 19) ^ (val >> 10);
+}
+
+static inline uint32_t SHA256_sigma_0 (uint32_t val){
+    return rotr32(val, 7) ^ rotr32(val, 18) ^ (val >> 3);
+}
+
+static inline uint32_t SHA256_big_sigma_1 (uint32_t val){
+    return rotr32(val, 6) ^ rotr32(val, 11) ^ rotr32(val, 25);
+}
+
+static inline uint32_t SHA256_big_sigma_0 (uint32_t val){
+    return rotr32(val, 2) ^ rotr32(val, 13) ^ rotr32(val, 22);
+}
+
+// choice and majority with one operation less than the textbook forms
+#define SHA256_CHOICE(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA256_MAJORITY(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+// the next schedule word, computed in place over the word from 16 rounds ago
+#define SHA256_SCHEDULE(w, i) \
+    ((w)[(i) & 15] += SHA256_sigma_1((w)[((i) - 2) & 15]) + (w)[((i) - 7) & 15] + SHA256_sigma_0((w)[((i) - 15) & 15]))
+
+// one round without moving the working variables: only d and h change, and the caller passes the next round
+// the same variables shifted one place to the right, so the old h is read as the new a
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i, word) do { \
+    uint32_t temp1 = (h) + SHA256_big_sigma_1(e) + SHA256_CHOICE(e, f, g) + SHA256_K_CONSTANTS[i] + (word); \
+    (d) += temp1; \
+    (h) = temp1 + SHA256_big_sigma_0(a) + SHA256_MAJORITY(a, b, c); \
+} while (0)
+
+// eight rounds bring the variables back to their own names; the first 16 words come straight from the block
+#define SHA256_WORD(w, i) ((i) < 16 ? (w)[(i) & 15] : SHA256_SCHEDULE(w, i))
+
+#define SHA256_EIGHT_ROUNDS(w, i) \
+    SHA256_ROUND(A, B, C, D, E, F, G, H, (i) + 0, SHA256_WORD(w, (i) + 0)); \
+    SHA256_ROUND(H, A, B, C, D, E, F, G, (i) + 1, SHA256_WORD(w, (i) + 1)); \
+    SHA256_ROUND(G, H, A, B, C, D, E, F, (i) + 2, SHA256_WORD(w, (i) + 2)); \
+    SHA256_ROUND(F, G, H, A, B, C, D, E, (i) + 3, SHA256_WORD(w, (i) + 3)); \
+    SHA256_ROUND(E, F, G, H, A, B, C, D, (i) + 4, SHA256_WORD(w, (i) + 4)); \
+    SHA256_ROUND(D, E, F, G, H, A, B, C, (i) + 5, SHA256_WORD(w, (i) + 5)); \
+    SHA256_ROUND(C, D, E, F, G, H, A, B, (i) + 6, SHA256_WORD(w, (i) + 6)); \
+    SHA256_ROUND(B, C, D, E, F, G, H, A, (i) + 7, SHA256_WORD(w, (i) + 7))
+
+
+//****************************************************************************************************************
+
+// compresses whole blocks read in place from the caller's buffer, nothing is copied or allocated.
+// all 64 rounds are unrolled so the working variables stay in registers and the schedule is a 16-word window.
+static void sha256_compress_blocks_scalar (uint32_t hash[8], const uint8_t *data, uint64_t num_of_blocks){
+    uint32_t A, B, C, D, E, F, G, H;
+    uint32_t message_schedule[16];
+
+    for (uint64_t block = 0; block < num_of_blocks; block++, data += 64){
+        for (uint8_t word = 0; word < 16; word++){
+            message_schedule[word] = load_be32(data + 4 * word);
+        }
+
+        A = hash[0];
+        B = hash[1];
+        C = hash[2];
+        D = hash[3];
+        E = hash[4];
+        F = hash[5];
+        G = hash[6];
+        H = hash[7];
+
+        SHA256_EIGHT_ROUNDS(message_schedule, 0);
+        SHA256_EIGHT_ROUNDS(message_schedule, 8);
+        SHA256_EIGHT_ROUNDS(message_schedule, 16);
+        SHA256_EIGHT_ROUNDS(message_schedule, 24);
+        SHA256_EIGHT_ROUNDS(message_schedule, 32);
+        SHA256_EIGHT_ROUNDS(message_schedule, 40);
+        SHA256_EIGHT_ROUNDS(message_schedule, 48);
+        SHA256_EIGHT_ROUNDS(message_schedule, 56);
+
+        hash[0] += A;
+        hash[1] += B;
+        hash[2] += C;
+        hash[3] += D;
+        hash[4] += E;
+        hash[5] += F;
+        hash[6] += G;
+        hash[7] += H;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// same as the scalar kernel but using the x86 sha extensions, 4 rounds per pair of sha256rnds2.
+// the state is kept as the ABEF/CDGH register pairs the instructions expect.
+__attribute__((target("sha,sse4.1")))
+static void sha256_compress_blocks_shani (uint32_t hash[8], const uint8_t *data, uint64_t num_of_blocks){
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, abef_save, cdgh_save, temp, message[4];
+
+    temp = _mm_loadu_si128((const __m128i *) &hash[0]);
+    state1 = _mm_loadu_si128((const __m128i *) &hash[4]);
+    temp = _mm_shuffle_epi32(temp, 0xB1);          // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);      // EFGH
+    state0 = _mm_alignr_epi8(temp, state1, 8);     // ABEF
+    state1 = _mm_blend_epi16(state1, temp, 0xF0);  // CDGH
+
+    for (uint64_t block = 0; block < num_of_blocks; block++, data += 64){
+        abef_save = state0;
+        cdgh_save = state1;
+
+        #pragma GCC unroll 16
+        for (uint32_t i = 0; i < 16; i++){
+            __m128i words;
+            if (i < 4){
+                words = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16 * i)), byte_swap);
+            } else {
+                // W[i] from W[i-4], W[i-3], W[i-2] and W[i-1], 4 words at a time
+                words = _mm_sha256msg1_epu32(message[i & 3], message[(i + 1) & 3]);
+                words = _mm_add_epi32(words, _mm_alignr_epi8(message[(i + 3) & 3], message[(i + 2) & 3], 4));
+                words = _mm_sha256msg2_epu32(words, message[(i + 3) & 3]);
+            }
+            message[i & 3] = words;
+
+            temp = _mm_add_epi32(words, _mm_loadu_si128((const __m128i *) &SHA256_K_CONSTANTS[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, temp);
+            temp = _mm_shuffle_epi32(temp, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, temp);
+        }
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    temp = _mm_shuffle_epi32(state0, 0x1B);        // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);      // DCHG
+    state0 = _mm_blend_epi16(temp, state1, 0xF0);  // DCBA
+    state1 = _mm_alignr_epi8(state1, temp, 8);     // HGFE
+    _mm_storeu_si128((__m128i *) &hash[0], state0);
+    _mm_storeu_si128((__m128i *) &hash[4], state1);
+}
+#endif
+
+//****************************************************************************************************************
+
+static void (*sha256_compress_blocks) (uint32_t hash[8], const uint8_t *data, uint64_t num_of_blocks) = sha256_compress_blocks_scalar;
+static enum sha256_kernel sha256_active_kernel = SHA256_KERNEL_SCALAR;
+
+static const char *SHA256_KERNEL_NAMES[SHA256_KERNEL_COUNT] = {"auto", "scalar", "shani"};
+
+const char *sha256_kernel_name(enum sha256_kernel kernel){
+    if (kernel >= SHA256_KERNEL_COUNT){
+        return "unknown";
+    }
+    return SHA256_KERNEL_NAMES[kernel];
+}
+
+enum sha256_kernel sha256_get_kernel(void){
+    return sha256_active_kernel;
+}
+
+// returns -1 and keeps the current kernel when the cpu does not support the requested one
+int sha256_set_kernel(enum sha256_kernel kernel){
+    uint32_t features = sha_cpu_features();
+
+    if (kernel == SHA256_KERNEL_AUTO){
+        kernel = (features & SHA_CPU_SHA) ? SHA256_KERNEL_SHANI : SHA256_KERNEL_SCALAR;
+    }
+    switch (kernel){
+        case SHA256_KERNEL_SCALAR:
+            sha256_compress_blocks = sha256_compress_blocks_scalar;
+            break;
+#if defined(__x86_64__) || defined(__i386__)
+        case SHA256_KERNEL_SHANI:
+            if (!(features & SHA_CPU_SHA)){
+                return -1;
+            }
+            sha256_compress_blocks = sha256_compress_blocks_shani;
+            break;
+#endif
+        default:
+            return -1;
+    }
+    sha256_active_kernel = kernel;
+    return 0;
+}
+
+// runs before main, SHA256_KERNEL=<name> in the environment forces a kernel for testing
+__attribute__((constructor))
+static void sha256_select_kernel (void){
+    const char *forced = getenv("SHA256_KERNEL");
+
+    if (forced != NULL){
+        for (uint32_t kernel = 0; kernel < SHA256_KERNEL_COUNT; kernel++){
+            if (strcmp(forced, SHA256_KERNEL_NAMES[kernel]) == 0 && sha256_set_kernel(kernel) == 0){
+                return;
+            }
+        }
+        fprintf(stderr, "Warning: SHA256_KERNEL=%s is not available, using auto\n", forced);
+    }
+    sha256_set_kernel(SHA256_KERNEL_AUTO);
+}
+
+void sha256_init(sha256_ctx *ctx){
+    for (uint8_t i = 0; i < 8; i++){
+        ctx->hash[i] = SHA256_INITIAL_HASH_VAL[i];
+    }
+    ctx->data_size_bytes = 0;
+    ctx->block_len = 0;
+    ctx->progress.fn = NULL;
+    ctx->stats = NULL;
+}
+
+// reports bytes hashed so far at most every every_bytes bytes or every every_ms milliseconds, call after init
+void sha256_set_progress(sha256_ctx *ctx, sha_progress_fn fn, void *user, uint64_t every_bytes, uint32_t every_ms){
+    sha_progress_set(&ctx->progress, fn, user, every_bytes, every_ms);
+}
+
+// counts this context's work into stats from now on, NULL stops counting. stats is not cleared first, so one
+// struct can add up several contexts used one after another, but never two at the same time
+void sha256_set_stats(sha256_ctx *ctx, sha_stats *stats){
+    ctx->stats = stats;
+    if (stats != NULL){
+        stats->kernel = sha256_kernel_name(sha256_active_kernel);
+    }
+}
+
+static inline void sha256_compress_counted (sha256_ctx *ctx, const uint8_t *data, uint64_t num_of_blocks){
+    uint64_t start_ns, start_cycles;
+
+    if (ctx->stats == NULL || num_of_blocks == 0){
+        sha256_compress_blocks(ctx->hash, data, num_of_blocks);
+        return;
+    }
+    start_ns = sha_now_ns();
+    start_cycles = sha_now_cycles();
+    sha256_compress_blocks(ctx->hash, data, num_of_blocks);
+    sha_stats_compressed(ctx->stats, num_of_blocks, start_ns, start_cycles);
+}
+
+// only the unfinished tail block is kept in the context, so memory use does not depend on the input size.
+// whole blocks are compressed directly from data.
+static void sha256_absorb (sha256_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes){
+    uint64_t num_of_blocks;
+
+    ctx->data_size_bytes += data_size_bytes;
+    if (ctx->block_len > 0){
+        uint32_t len = 64 - ctx->block_len;
+        if (data_size_bytes < len){
+            len = (uint32_t) data_size_bytes;
+        }
+        memcpy(ctx->block + ctx->block_len, data, len);
+        ctx->block_len += len;
+        if (ctx->stats != NULL){
+            ctx->stats->copied_bytes += len;
+        }
+        data += len;
+        data_size_bytes -= len;
+
+        if (ctx->block_len < 64){
+            return;
+        }
+        sha256_compress_counted(ctx, ctx->block, 1);
+        ctx->block_len = 0;
+    }
+
+    num_of_blocks = data_size_bytes / 64;
+    sha256_compress_counted(ctx, data, num_of_blocks);
+    data += num_of_blocks * 64;
+    data_size_bytes -= num_of_blocks * 64;
+
+    memcpy(ctx->block, data, data_size_bytes);
+    ctx->block_len = (uint32_t) data_size_bytes;
+    if (ctx->stats != NULL){
+        ctx->stats->copied_bytes += data_size_bytes;
+    }
+}
+
+void sha256_update(sha256_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes){
+    uint64_t slice;
+
+    if (ctx->stats != NULL){
+        ctx->stats->bytes += data_size_bytes;
+    }
+    if (ctx->progress.fn == NULL){
+        sha256_absorb(ctx, data, data_size_bytes);
+        return;
+    }
+    slice = sha_progress_slice(&ctx->progress);
+    while (data_size_bytes > 0){
+        uint64_t len = (data_size_bytes < slice) ? data_size_bytes : slice;
+        sha256_absorb(ctx, data, len);
+        data += len;
+        data_size_bytes -= len;
+        sha_progress_report(&ctx->progress, ctx->data_size_bytes);
+    }
+}
+
+// writes the tail, the 0x80 marker and the 8 byte bit length into padding and returns how many blocks that
+// took: one, or two when the tail is too long to leave room for the length
+static uint32_t sha256_pad (uint8_t padding[128], const uint8_t *tail, uint32_t tail_len, uint64_t data_size_bytes){
+    uint32_t padded_size = 64;
+
+    if (tail_len >= 56){
+        padded_size = 128;
+    }
+    memcpy(padding, tail, tail_len);
+    memset(padding + tail_len, 0x0, padded_size - tail_len);
+    padding[tail_len] = 0x80;
+    store_be64(padding + padded_size - 8, data_size_bytes * 8);
+    return padded_size / 64;
+}
+
+void sha256_final(sha256_ctx *ctx, uint8_t digest[32]){
+    uint8_t padding[128];
+    uint32_t num_of_blocks;
+    uint64_t start_ns = (ctx->stats != NULL) ? sha_now_ns() : 0;
+
+    num_of_blocks = sha256_pad(padding, ctx->block, ctx->block_len, ctx->data_size_bytes);
+    if (ctx->stats != NULL){
+        ctx->stats->pad_ns += sha_now_ns() - start_ns;
+    }
+    sha256_compress_counted(ctx, padding, num_of_blocks);
+
+    for (uint32_t i = 0; i < 8; i++){
+        store_be32(digest + 4 * i, ctx->hash[i]);
+    }
+}
+
+// one-block messages (up to 55 bytes) skip the context: the padding is built on the stack and compressed once.
+// always inlined, so with a length known at compile time the copy and the padding fold into a few stores.
+static inline __attribute__((always_inline))
+void sha256_one_block (const uint8_t *data, uint32_t data_size_bytes, uint8_t digest[32]){
+    uint8_t block[64];
+    uint32_t hash[8];
+
+    memcpy(hash, SHA256_INITIAL_HASH_VAL, sizeof(hash));
+    memcpy(block, data, data_size_bytes);
+    block[data_size_bytes] = 0x80;
+    memset(block + data_size_bytes + 1, 0x0, 56 - data_size_bytes - 1);
+    store_be64(block + 56, (uint64_t) data_size_bytes * 8);
+    sha256_compress_blocks(hash, block, 1);
+    for (uint32_t i = 0; i < 8; i++){
+        store_be32(digest + 4 * i, hash[i]);
+    }
+}
+
+// hashes data into the caller's buffer without allocating
+static inline __attribute__((always_inline))
+void sha256_digest(const uint8_t *data, uint64_t data_size_bytes, uint8_t digest[32]){
+    sha256_ctx ctx;
+
+    if (data_size_bytes <= SHA256_ONE_BLOCK_MAX){
+        sha256_one_block(data, (uint32_t) data_size_bytes, digest);
+        return;
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, data_size_bytes);
+    sha256_final(&ctx, digest);
+}
+
+#define SHA256_STATE_MAGIC "s256"
+#define SHA256_STATE_VERSION 1
+
+// copies everything absorbed so far into dst, which can then be finished with a different suffix than src;
+// progress reporting and stats are not copied
+void sha256_clone(sha256_ctx *dst, const sha256_ctx *src){
+    *dst = *src;
+    dst->progress.fn = NULL;
+    dst->stats = NULL;
+}
+
+// the exported state is big-endian and fixed size, so it can be stored or sent to another machine:
+//     bytes 0-3    magic "s256"
+//     byte  4      format version
+//     bytes 5-7    zero
+//     bytes 8-15   bytes absorbed so far
+//     bytes 16-47  the 8 hash words
+//     bytes 48-111 the unfinished block, zero past its end (its length is the byte count mod 64)
+void sha256_export(const sha256_ctx *ctx, uint8_t state[SHA256_STATE_SIZE]){
+    memset(state, 0, SHA256_STATE_SIZE);
+    memcpy(state, SHA256_STATE_MAGIC, 4);
+    state[4] = SHA256_STATE_VERSION;
+    store_be64(state + 8, ctx->data_size_bytes);
+    for (uint32_t i = 0; i < 8; i++){
+        store_be32(state + 16 + 4 * i, ctx->hash[i]);
+    }
+    memcpy(state + 16 + 32, ctx->block, ctx->block_len);
+}
+
+// returns -1 and leaves ctx alone when the blob is not a sha256 state of this version
+int sha256_import(sha256_ctx *ctx, const uint8_t state[SHA256_STATE_SIZE]){
+    if (memcmp(state, SHA256_STATE_MAGIC, 4) != 0 || state[4] != SHA256_STATE_VERSION){
+        return -1;
+    }
+    sha256_init(ctx);
+    ctx->data_size_bytes = load_be64(state + 8);
+    for (uint32_t i = 0; i < 8; i++){
+        ctx->hash[i] = load_be32(state + 16 + 4 * i);
+    }
+    ctx->block_len = (uint32_t) (ctx->data_size_bytes % 64);
+    memcpy(ctx->block, state + 16 + 32, ctx->block_len);
+    return 0;
+}
+
+uint8_t *sha256(uint8_t *data, uint64_t data_size_bytes){
+    uint8_t *digest = (uint8_t *) malloc(32 * sizeof(uint8_t));
+
+    if (digest == NULL){
+        return NULL;
+    }
+    sha256_digest(data, data_size_bytes, digest);
+    return digest;
 }
\ No newline at end of file
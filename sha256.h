@@ -1,8 +1,54 @@
-#ifndef SHA256_H
-#define SHA256_H
-#include <stdint.h>
-#include "sha256.c"
-
-uint8_t *sha256(uint8_t *data, uint64_t data_size_bytes);
-
+#ifndef SHA256_H
+#define SHA256_H
+#include <stdint.h>
+#include "sha_helpers.h"
+
+// streaming state: the running hash, how many bytes have been absorbed, and the
+// partial block that has not been compressed yet
+typedef struct sha256_ctx {
+    uint32_t hash[8];
+    uint64_t data_size_bytes;
+    uint8_t block[64];
+    uint32_t block_len;
+    sha_progress progress;
+    sha_stats *stats;
+} sha256_ctx;
+
+// compression kernels, SHA256_KERNEL_AUTO picks the fastest one the cpu supports
+enum sha256_kernel {SHA256_KERNEL_AUTO, SHA256_KERNEL_SCALAR, SHA256_KERNEL_SHANI, SHA256_KERNEL_COUNT};
+
+// longest message that still fits in one padded block
+#define SHA256_ONE_BLOCK_MAX 55
+
+// size of an exported context: magic and version, byte count, hash words and the unfinished block
+#define SHA256_STATE_SIZE 112
+
+#include "sha256.c"
+
+void sha256_init(sha256_ctx *ctx);
+
+void sha256_update(sha256_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes);
+
+void sha256_set_progress(sha256_ctx *ctx, sha_progress_fn fn, void *user, uint64_t every_bytes, uint32_t every_ms);
+
+void sha256_set_stats(sha256_ctx *ctx, sha_stats *stats);
+
+void sha256_final(sha256_ctx *ctx, uint8_t digest[32]);
+
+static inline void sha256_digest(const uint8_t *data, uint64_t data_size_bytes, uint8_t digest[32]);
+
+void sha256_clone(sha256_ctx *dst, const sha256_ctx *src);
+
+void sha256_export(const sha256_ctx *ctx, uint8_t state[SHA256_STATE_SIZE]);
+
+int sha256_import(sha256_ctx *ctx, const uint8_t state[SHA256_STATE_SIZE]);
+
+uint8_t *sha256(uint8_t *data, uint64_t data_size_bytes);
+
+int sha256_set_kernel(enum sha256_kernel kernel);
+
+enum sha256_kernel sha256_get_kernel(void);
+
+const char *sha256_kernel_name(enum sha256_kernel kernel);
+
 #endif
\ No newline at end of file
@@ -1,209 +1,497 @@
-#include <stdint.h>
-#include <stdlib.h>
-#include <stdio.h>
-
-#include "sha512.h"
-#include "sha_helpers.h"
-
-static const uint64_t SHA512_INITIAL_HASH_VAL[8] = {0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
-                                            0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179};
-
-static const uint64_t SHA512_K_CONSTANTS[80] = {0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
-                                         0x3956c25bf348b538, 0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
-                                         0xd807aa98a3030242, 0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
-                                         0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235, 0xc19bf174cf692694,
-                                         0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
-                                         0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
-                                         0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4,
-                                         0xc6e00bf33da88fc2, 0xd5a79147930aa725, 0x06ca6351e003826f, 0x142929670a0e6e70,
-                                         0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
-                                         0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
-                                         0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30,
-                                         0xd192e819d6ef5218, 0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
-                                         0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8,
-                                         0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3,
-                                         0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
-                                         0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b,
-                                         0xca273eceea26619c, 0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178,
-                                         0x06f067aa72176fba, 0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
-                                         0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
-                                         0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
-
-//****************************************************************************************************************
-static uint64_t SHA512_sigma_0 (uint64_t val){
-    uint64_t rotate_right_1 = (val >> 1) | (val << 63);
-    uint64_t rotate_right_8 = (val >> 8) | (val << 56);
-    uint64_t shift_right_7 = val >> 7;
-
-    return rotate_right_1 ^ rotate_right_8 ^ shift_right_7;
-}
-
-static uint64_t SHA512_sigma_1 (uint64_t val){
-    uint64_t rotate_right_19 = (val >> 19) | (val << 45);
-    uint64_t rotate_right_61 = (val >> 61) | (val << 3);
-    uint64_t shift_right_6 = val >> 6;
-
-    return rotate_right_19 ^ rotate_right_61 ^ shift_right_6;
-}
-
-static uint64_t SHA512_big_sigma_0 (uint64_t val){
-    uint64_t rotate_right_28 = (val >> 28) | (val << 36);
-    uint64_t rotate_right_34 = (val >> 34) | (val << 30);
-    uint64_t rotate_right_39 = (val >> 39) | (val << 25);
-
-    return rotate_right_28 ^ rotate_right_34 ^ rotate_right_39;
-}
-
-static uint64_t SHA512_big_sigma_1 (uint64_t val){
-    uint64_t rotate_right_14 = (val >> 14) | (val << 50);
-    uint64_t rotate_right_18 = (val >> 18) | (val << 46);
-    uint64_t rotate_right_41 = (val >> 41) | (val << 23);
-
-    return rotate_right_14 ^ rotate_right_18 ^ rotate_right_41;
-}
-
-uint64_t *sha512(uint8_t *data, uint64_t data_size_bytes){ // returns array of 64 8-bit numbers
-    uint64_t data_size_bits;
-    uint32_t num_of_blocks;
-    uint64_t **data_blocks;
- 
-    uint64_t message_schedule[64];
-
-    uint64_t hash[8], temp_hash[8], temp1, temp2; 
-    uint64_t *digest;
-
-    data_size_bits = data_size_bytes * 8;
-    num_of_blocks = ceil_divide(data_size_bytes, 1024);
-
-    printf("Allocating %lu bytes in memory (%lu blocks)...\n" , data_size_bytes, num_of_blocks);
-    data_blocks = (uint64_t **) malloc(num_of_blocks * sizeof(uint8_t *));
-    for (uint32_t i = 0; i < num_of_blocks; i++){
-        data_blocks[i] = (uint64_t *) malloc(64 * sizeof(uint64_t));
-    }
-
-    printf("Pre-processing blocks...\n");
-    for (uint32_t block = 0; block < num_of_blocks; block++){
-        if (block == num_of_blocks - 1){ // if in last block 
-            uint32_t len = data_size_bytes % 128;
-            for (uint32_t byte = 0; byte < len; byte++){
-                data_blocks[block][byte] = data[(block * 128) + byte];
-            }
-            data_blocks[block][len] = 0x80;
-
-            for (uint32_t byte = len + 1; byte < 120; byte++){
-                data_blocks[block][byte] = 0x0;
-            }
-
-            data_blocks[block][112] = 0x0;
-            data_blocks[block][113] = 0x0;
-            data_blocks[block][114] = 0x0;
-            data_blocks[block][115] = 0x0;
-            data_blocks[block][116] = 0x0;
-            data_blocks[block][117] = 0x0;
-            data_blocks[block][118] = 0x0;
-            data_blocks[block][119] = 0x0;
-            data_blocks[block][120] = (data_size_bits >> 56) & 0x00000000000000FF;
-            data_blocks[block][121] = (data_size_bits >> 48) & 0x00000000000000FF;
-            data_blocks[block][122] = (data_size_bits >> 40) & 0x00000000000000FF;
-            data_blocks[block][123] = (data_size_bits >> 32) & 0x00000000000000FF;
-            data_blocks[block][124] = (data_size_bits >> 24) & 0x00000000000000FF;
-            data_blocks[block][125] = (data_size_bits >> 16) & 0x00000000000000FF;
-            data_blocks[block][126] = (data_size_bits >> 8) & 0x00000000000000FF;
-            data_blocks[block][127] = data_size_bits & 0x00000000000000FF;
-        } else {
-            for (uint32_t byte = 0; byte < 128; byte++){
-                data_blocks[block][byte] = data[(block * 128) + byte];
-            }
-        }
-        if (num_of_blocks > 1000){
-            if ((block % 1000) == 0 || (block == num_of_blocks - 1)){
-                print_progress_bar((uint64_t) block, 50, 0, (uint64_t) (num_of_blocks - 1));
-            }
-        } else {
-            print_progress_bar((uint64_t) block, 50, 0, (uint64_t) (num_of_blocks - 1));
-        }
-    }
-
-    printf("\nFilling hash register...\n");
-    for (uint8_t i = 0; i < 8; i++){
-        hash[i] = SHA512_INITIAL_HASH_VAL[i];
-        if (i % 2){
-            print_progress_bar((uint64_t) i, 50, 0, (uint64_t) 7);
-        }
-    }
-
-    printf("\nHashing Data...\n");
-    for (uint32_t block = 0; block < num_of_blocks; block++){
-        for (uint8_t byte = 0; byte < 64; byte += 4){
-            message_schedule[byte / 4] = (((uint32_t) data_blocks[block][byte]) << 24)     |
-                                         (((uint32_t) data_blocks[block][byte + 1]) << 16) |
-                                         (((uint32_t) data_blocks[block][byte + 2]) << 8)  |
-                                         ((uint32_t) data_blocks[block][byte + 3]);
-        }
-        
-        for (uint32_t i = 16; i < 80; i++){
-            message_schedule[i] = SHA512_sigma_1(message_schedule[i - 2]) + message_schedule[ i - 7] 
-                                + SHA512_sigma_0(message_schedule[i - 15]) + message_schedule[i - 16];
-        }
-        temp_hash[a] = hash[0];
-        temp_hash[b] = hash[1];
-        temp_hash[c] = hash[2];
-        temp_hash[d] = hash[3];
-        temp_hash[e] = hash[4];
-        temp_hash[f] = hash[5];
-        temp_hash[g] = hash[6];
-        temp_hash[h] = hash[7];
-
-        for (uint32_t i = 0; i < 80; i++){
-            temp1 = SHA512_big_sigma_1(temp_hash[e]) + choice(temp_hash[e], temp_hash[f], temp_hash[g]) + 
-                    SHA512_K_CONSTANTS[i]  + message_schedule[i] + temp_hash[h];
-            temp1 = SHA512_big_sigma_0(temp_hash[a]) + majority(temp_hash[a], temp_hash[b], temp_hash[c]);
-
-            temp_hash[h] = hash[g];
-            temp_hash[g] = hash[f];
-            temp_hash[f] = hash[e];
-            temp_hash[e] = hash[d]; + temp1;
-            temp_hash[d] = hash[c];
-            temp_hash[c] = hash[b];
-            temp_hash[b] = hash[a];
-            temp_hash[a] = temp1 + temp2;
-        }
-        hash[0] += temp_hash[a];
-        hash[1] += temp_hash[b];
-        hash[2] += temp_hash[c];
-        hash[3] += temp_hash[d];
-        hash[4] += temp_hash[e];
-        hash[5] += temp_hash[f];
-        hash[6] += temp_hash[g];
-        hash[7] += temp_hash[h];
-
-        if (num_of_blocks > 1001){
-            if ((block % 100) == 0){
-                print_progress_bar((uint64_t) block, 50, 0, (uint64_t) (num_of_blocks - 1));
-            }
-        } else {
-            print_progress_bar((uint64_t) block, 50, 0, (uint64_t) (num_of_blocks - 1));
-        }
-    }
-    printf("\nReturning blocks to the heap...\n");
-    for (uint32_t i = 0; i < num_of_blocks; i++){
-        free(data_blocks[i]);
-        if (num_of_blocks > 1001){
-            if ((i % 100) == 0){
-                print_progress_bar((uint64_t) i, 50, 0, (uint64_t) (num_of_blocks - 1));
-            }
-        } else {
-            print_progress_bar((uint64_t) i, 50, 0, (uint64_t) (num_of_blocks - 1));
-        }
-    }
-    free(data_blocks);
-    digest = (uint64_t *) malloc(8 * sizeof(uint64_t));
-
-    for (uint32_t i = 0; i < 2; i++){
-        digest[i] = (uint64_t) ((hash[i / 4] >> 25 & 0x000000FF));
-        digest[i + 1] = (uint64_t) ((hash[i / 4] >> 16 & 0x000000FF));
-        digest[i + 2] = (uint64_t) ((hash[i / 4] >> 8 & 0x000000FF));
-        digest[i + 3] = (uint64_t) ((hash[i / 4] & 0x000000FF));
-    }
-    return digest;
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sha512.h"
+#include "sha_helpers.h"
+#include "sha_cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static const uint64_t SHA512_INITIAL_HASH_VAL[8] = {0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+                                            0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179};
+
+static const uint64_t SHA512_K_CONSTANTS[80] = {0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
+                                         0x3956c25bf348b538, 0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
+                                         0xd807aa98a3030242, 0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+                                         0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235, 0xc19bf174cf692694,
+                                         0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+                                         0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+                                         0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4,
+                                         0xc6e00bf33da88fc2, 0xd5a79147930aa725, 0x06ca6351e003826f, 0x142929670a0e6e70,
+                                         0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+                                         0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+                                         0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30,
+                                         0xd192e819d6ef5218, 0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+                                         0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8,
+                                         0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3,
+                                         0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+                                         0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b,
+                                         0xca273eceea26619c, 0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178,
+                                         0x06f067aa72176fba, 0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+                                         0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
+                                         0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
+
+//****************************************************************************************************************
+static inline uint64_t SHA512_sigma_0 (uint64_t val){
+    return rotr64(val, 1) ^ rotr64(val, 8) ^ (val >> 7);
+}
+
+static inline uint64_t SHA512_sigma_1 (uint64_t val){
+    return rotr64(val, 19) ^ rotr64(val, 61) ^ (val >> 6);
+}
+
+static inline uint64_t SHA512_big_sigma_0 (uint64_t val){
+    return rotr64(val, 28) ^ rotr64(val, 34) ^ rotr64(val, 39);
+}
+
+static inline uint64_t SHA512_big_sigma_1 (uint64_t val){
+    return rotr64(val, 14) ^ rotr64(val, 18) ^ rotr64(val, 41);
+}
+
+// same round structure as sha256.c, see the comments there
+#define SHA512_CHOICE(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA512_MAJORITY(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+#define SHA512_SCHEDULE(w, i) \
+    ((w)[(i) & 15] += SHA512_sigma_1((w)[((i) - 2) & 15]) + (w)[((i) - 7) & 15] + SHA512_sigma_0((w)[((i) - 15) & 15]))
+
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, i, word) do { \
+    uint64_t temp1 = (h) + SHA512_big_sigma_1(e) + SHA512_CHOICE(e, f, g) + SHA512_K_CONSTANTS[i] + (word); \
+    (d) += temp1; \
+    (h) = temp1 + SHA512_big_sigma_0(a) + SHA512_MAJORITY(a, b, c); \
+} while (0)
+
+#define SHA512_WORD(w, i) ((i) < 16 ? (w)[(i) & 15] : SHA512_SCHEDULE(w, i))
+
+#define SHA512_EIGHT_ROUNDS(w, i) \
+    SHA512_ROUND(A, B, C, D, E, F, G, H, (i) + 0, SHA512_WORD(w, (i) + 0)); \
+    SHA512_ROUND(H, A, B, C, D, E, F, G, (i) + 1, SHA512_WORD(w, (i) + 1)); \
+    SHA512_ROUND(G, H, A, B, C, D, E, F, (i) + 2, SHA512_WORD(w, (i) + 2)); \
+    SHA512_ROUND(F, G, H, A, B, C, D, E, (i) + 3, SHA512_WORD(w, (i) + 3)); \
+    SHA512_ROUND(E, F, G, H, A, B, C, D, (i) + 4, SHA512_WORD(w, (i) + 4)); \
+    SHA512_ROUND(D, E, F, G, H, A, B, C, (i) + 5, SHA512_WORD(w, (i) + 5)); \
+    SHA512_ROUND(C, D, E, F, G, H, A, B, (i) + 6, SHA512_WORD(w, (i) + 6)); \
+    SHA512_ROUND(B, C, D, E, F, G, H, A, (i) + 7, SHA512_WORD(w, (i) + 7))
+
+// compresses whole blocks read in place from the caller's buffer, nothing is copied or allocated.
+// all 80 rounds are unrolled so the working variables stay in registers and the schedule is a 16-word window.
+static void sha512_compress_blocks_scalar (uint64_t hash[8], const uint8_t *data, uint64_t num_of_blocks){
+    uint64_t A, B, C, D, E, F, G, H;
+    uint64_t message_schedule[16];
+
+    for (uint64_t block = 0; block < num_of_blocks; block++, data += 128){
+        for (uint8_t word = 0; word < 16; word++){
+            message_schedule[word] = load_be64(data + 8 * word);
+        }
+
+        A = hash[0];
+        B = hash[1];
+        C = hash[2];
+        D = hash[3];
+        E = hash[4];
+        F = hash[5];
+        G = hash[6];
+        H = hash[7];
+
+        SHA512_EIGHT_ROUNDS(message_schedule, 0);
+        SHA512_EIGHT_ROUNDS(message_schedule, 8);
+        SHA512_EIGHT_ROUNDS(message_schedule, 16);
+        SHA512_EIGHT_ROUNDS(message_schedule, 24);
+        SHA512_EIGHT_ROUNDS(message_schedule, 32);
+        SHA512_EIGHT_ROUNDS(message_schedule, 40);
+        SHA512_EIGHT_ROUNDS(message_schedule, 48);
+        SHA512_EIGHT_ROUNDS(message_schedule, 56);
+        SHA512_EIGHT_ROUNDS(message_schedule, 64);
+        SHA512_EIGHT_ROUNDS(message_schedule, 72);
+
+        hash[0] += A;
+        hash[1] += B;
+        hash[2] += C;
+        hash[3] += D;
+        hash[4] += E;
+        hash[5] += F;
+        hash[6] += G;
+        hash[7] += H;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// there is no sha512 counterpart of the sha extensions, so only the message schedule is vectorized: four words
+// per ymm register, computed for the rounds 16 ahead while the scalar rounds run, with the round constants
+// already added. the rounds themselves stay scalar and get rorx from bmi2.
+#define SHA512_AVX2_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - (n)))
+
+#define SHA512_AVX2_SIGMA_0(x) \
+    _mm256_xor_si256(_mm256_xor_si256(SHA512_AVX2_ROTR(x, 1), SHA512_AVX2_ROTR(x, 8)), _mm256_srli_epi64(x, 7))
+
+#define SHA512_AVX2_SIGMA_1(x) \
+    _mm256_xor_si256(_mm256_xor_si256(SHA512_AVX2_ROTR(x, 19), SHA512_AVX2_ROTR(x, 61)), _mm256_srli_epi64(x, 6))
+
+// W[t+16..t+19] from W[t..t+15] held in w0..w3. the sigma_1 terms of the last two words need the first two,
+// so sigma_1 is applied twice: once for W[t+14..t+15], then again with the two new words shifted in
+__attribute__((target("avx2")))
+static inline __m256i sha512_avx2_schedule (__m256i w0, __m256i w1, __m256i w2, __m256i w3){
+    __m256i w1_4 = _mm256_alignr_epi8(_mm256_permute2x128_si256(w0, w1, 0x21), w0, 8);
+    __m256i w9_12 = _mm256_alignr_epi8(_mm256_permute2x128_si256(w2, w3, 0x21), w2, 8);
+    __m256i partial = _mm256_add_epi64(_mm256_add_epi64(w0, SHA512_AVX2_SIGMA_0(w1_4)), w9_12);
+    __m256i low = _mm256_add_epi64(partial, SHA512_AVX2_SIGMA_1(_mm256_permute4x64_epi64(w3, 0xEE)));
+
+    return _mm256_add_epi64(partial, SHA512_AVX2_SIGMA_1(_mm256_permute2x128_si256(w3, low, 0x21)));
+}
+
+// same as SHA512_ROUND with the round constant already added to the word
+#define SHA512_ROUND_WK(a, b, c, d, e, f, g, h, wk) do { \
+    uint64_t temp1 = (h) + SHA512_big_sigma_1(e) + SHA512_CHOICE(e, f, g) + (wk); \
+    (d) += temp1; \
+    (h) = temp1 + SHA512_big_sigma_0(a) + SHA512_MAJORITY(a, b, c); \
+} while (0)
+
+#define SHA512_EIGHT_ROUNDS_WK(wk, i) \
+    SHA512_ROUND_WK(A, B, C, D, E, F, G, H, (wk)[(i) + 0]); \
+    SHA512_ROUND_WK(H, A, B, C, D, E, F, G, (wk)[(i) + 1]); \
+    SHA512_ROUND_WK(G, H, A, B, C, D, E, F, (wk)[(i) + 2]); \
+    SHA512_ROUND_WK(F, G, H, A, B, C, D, E, (wk)[(i) + 3]); \
+    SHA512_ROUND_WK(E, F, G, H, A, B, C, D, (wk)[(i) + 4]); \
+    SHA512_ROUND_WK(D, E, F, G, H, A, B, C, (wk)[(i) + 5]); \
+    SHA512_ROUND_WK(C, D, E, F, G, H, A, B, (wk)[(i) + 6]); \
+    SHA512_ROUND_WK(B, C, D, E, F, G, H, A, (wk)[(i) + 7])
+
+__attribute__((target("avx2,bmi2")))
+static void sha512_compress_blocks_avx2 (uint64_t hash[8], const uint8_t *data, uint64_t num_of_blocks){
+    const __m256i byte_swap = _mm256_set_epi64x(0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL,
+                                                0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL);
+    uint64_t A, B, C, D, E, F, G, H;
+    uint64_t wk[80] __attribute__((aligned(32)));
+    __m256i w0, w1, w2, w3, w4, w5;
+
+    for (uint64_t block = 0; block < num_of_blocks; block++, data += 128){
+        w0 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (data + 0)), byte_swap);
+        w1 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (data + 32)), byte_swap);
+        w2 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (data + 64)), byte_swap);
+        w3 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (data + 96)), byte_swap);
+        _mm256_store_si256((__m256i *) &wk[0], _mm256_add_epi64(w0, _mm256_loadu_si256((const __m256i *) &SHA512_K_CONSTANTS[0])));
+        _mm256_store_si256((__m256i *) &wk[4], _mm256_add_epi64(w1, _mm256_loadu_si256((const __m256i *) &SHA512_K_CONSTANTS[4])));
+        _mm256_store_si256((__m256i *) &wk[8], _mm256_add_epi64(w2, _mm256_loadu_si256((const __m256i *) &SHA512_K_CONSTANTS[8])));
+        _mm256_store_si256((__m256i *) &wk[12], _mm256_add_epi64(w3, _mm256_loadu_si256((const __m256i *) &SHA512_K_CONSTANTS[12])));
+
+        A = hash[0];
+        B = hash[1];
+        C = hash[2];
+        D = hash[3];
+        E = hash[4];
+        F = hash[5];
+        G = hash[6];
+        H = hash[7];
+
+        // the schedule for rounds t+16..t+23 has no dependency on rounds t..t+7, so both fill the pipeline
+        #pragma GCC unroll 10
+        for (uint32_t t = 0; t < 80; t += 8){
+            if (t < 64){
+                w4 = sha512_avx2_schedule(w0, w1, w2, w3);
+                w5 = sha512_avx2_schedule(w1, w2, w3, w4);
+                _mm256_store_si256((__m256i *) &wk[t + 16],
+                                   _mm256_add_epi64(w4, _mm256_loadu_si256((const __m256i *) &SHA512_K_CONSTANTS[t + 16])));
+                _mm256_store_si256((__m256i *) &wk[t + 20],
+                                   _mm256_add_epi64(w5, _mm256_loadu_si256((const __m256i *) &SHA512_K_CONSTANTS[t + 20])));
+                w0 = w2;
+                w1 = w3;
+                w2 = w4;
+                w3 = w5;
+            }
+            SHA512_EIGHT_ROUNDS_WK(wk, t);
+        }
+
+        hash[0] += A;
+        hash[1] += B;
+        hash[2] += C;
+        hash[3] += D;
+        hash[4] += E;
+        hash[5] += F;
+        hash[6] += G;
+        hash[7] += H;
+    }
+}
+#endif
+
+//****************************************************************************************************************
+
+static void (*sha512_compress_blocks) (uint64_t hash[8], const uint8_t *data, uint64_t num_of_blocks) = sha512_compress_blocks_scalar;
+static enum sha512_kernel sha512_active_kernel = SHA512_KERNEL_SCALAR;
+
+static const char *SHA512_KERNEL_NAMES[SHA512_KERNEL_COUNT] = {"auto", "scalar", "avx2"};
+
+const char *sha512_kernel_name(enum sha512_kernel kernel){
+    if (kernel >= SHA512_KERNEL_COUNT){
+        return "unknown";
+    }
+    return SHA512_KERNEL_NAMES[kernel];
+}
+
+enum sha512_kernel sha512_get_kernel(void){
+    return sha512_active_kernel;
+}
+
+// returns -1 and keeps the current kernel when the cpu does not support the requested one
+int sha512_set_kernel(enum sha512_kernel kernel){
+    uint32_t features = sha_cpu_features();
+    uint32_t avx2 = SHA_CPU_AVX2 | SHA_CPU_BMI2;
+
+    if (kernel == SHA512_KERNEL_AUTO){
+        kernel = ((features & avx2) == avx2) ? SHA512_KERNEL_AVX2 : SHA512_KERNEL_SCALAR;
+    }
+    switch (kernel){
+        case SHA512_KERNEL_SCALAR:
+            sha512_compress_blocks = sha512_compress_blocks_scalar;
+            break;
+#if defined(__x86_64__) || defined(__i386__)
+        case SHA512_KERNEL_AVX2:
+            if ((features & avx2) != avx2){
+                return -1;
+            }
+            sha512_compress_blocks = sha512_compress_blocks_avx2;
+            break;
+#endif
+        default:
+            return -1;
+    }
+    sha512_active_kernel = kernel;
+    return 0;
+}
+
+// runs before main, SHA512_KERNEL=<name> in the environment forces a kernel for testing
+__attribute__((constructor))
+static void sha512_select_kernel (void){
+    const char *forced = getenv("SHA512_KERNEL");
+
+    if (forced != NULL){
+        for (uint32_t kernel = 0; kernel < SHA512_KERNEL_COUNT; kernel++){
+            if (strcmp(forced, SHA512_KERNEL_NAMES[kernel]) == 0 && sha512_set_kernel(kernel) == 0){
+                return;
+            }
+        }
+        fprintf(stderr, "Warning: SHA512_KERNEL=%s is not available, using auto\n", forced);
+    }
+    sha512_set_kernel(SHA512_KERNEL_AUTO);
+}
+
+void sha512_init(sha512_ctx *ctx){
+    for (uint8_t i = 0; i < 8; i++){
+        ctx->hash[i] = SHA512_INITIAL_HASH_VAL[i];
+    }
+    ctx->data_size_bytes = 0;
+    ctx->block_len = 0;
+    ctx->progress.fn = NULL;
+    ctx->stats = NULL;
+}
+
+// reports bytes hashed so far at most every every_bytes bytes or every every_ms milliseconds, call after init
+void sha512_set_progress(sha512_ctx *ctx, sha_progress_fn fn, void *user, uint64_t every_bytes, uint32_t every_ms){
+    sha_progress_set(&ctx->progress, fn, user, every_bytes, every_ms);
+}
+
+// counts this context's work into stats from now on, NULL stops counting. stats is not cleared first, so one
+// struct can add up several contexts used one after another, but never two at the same time
+void sha512_set_stats(sha512_ctx *ctx, sha_stats *stats){
+    ctx->stats = stats;
+    if (stats != NULL){
+        stats->kernel = sha512_kernel_name(sha512_active_kernel);
+    }
+}
+
+static inline void sha512_compress_counted (sha512_ctx *ctx, const uint8_t *data, uint64_t num_of_blocks){
+    uint64_t start_ns, start_cycles;
+
+    if (ctx->stats == NULL || num_of_blocks == 0){
+        sha512_compress_blocks(ctx->hash, data, num_of_blocks);
+        return;
+    }
+    start_ns = sha_now_ns();
+    start_cycles = sha_now_cycles();
+    sha512_compress_blocks(ctx->hash, data, num_of_blocks);
+    sha_stats_compressed(ctx->stats, num_of_blocks, start_ns, start_cycles);
+}
+
+// only the unfinished tail block is kept in the context, so memory use does not depend on the input size.
+// whole blocks are compressed directly from data.
+static void sha512_absorb (sha512_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes){
+    uint64_t num_of_blocks;
+
+    ctx->data_size_bytes += data_size_bytes;
+    if (ctx->block_len > 0){
+        uint32_t len = 128 - ctx->block_len;
+        if (data_size_bytes < len){
+            len = (uint32_t) data_size_bytes;
+        }
+        memcpy(ctx->block + ctx->block_len, data, len);
+        ctx->block_len += len;
+        if (ctx->stats != NULL){
+            ctx->stats->copied_bytes += len;
+        }
+        data += len;
+        data_size_bytes -= len;
+
+        if (ctx->block_len < 128){
+            return;
+        }
+        sha512_compress_counted(ctx, ctx->block, 1);
+        ctx->block_len = 0;
+    }
+
+    num_of_blocks = data_size_bytes / 128;
+    sha512_compress_counted(ctx, data, num_of_blocks);
+    data += num_of_blocks * 128;
+    data_size_bytes -= num_of_blocks * 128;
+
+    memcpy(ctx->block, data, data_size_bytes);
+    ctx->block_len = (uint32_t) data_size_bytes;
+    if (ctx->stats != NULL){
+        ctx->stats->copied_bytes += data_size_bytes;
+    }
+}
+
+void sha512_update(sha512_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes){
+    uint64_t slice;
+
+    if (ctx->stats != NULL){
+        ctx->stats->bytes += data_size_bytes;
+    }
+    if (ctx->progress.fn == NULL){
+        sha512_absorb(ctx, data, data_size_bytes);
+        return;
+    }
+    slice = sha_progress_slice(&ctx->progress);
+    while (data_size_bytes > 0){
+        uint64_t len = (data_size_bytes < slice) ? data_size_bytes : slice;
+        sha512_absorb(ctx, data, len);
+        data += len;
+        data_size_bytes -= len;
+        sha_progress_report(&ctx->progress, ctx->data_size_bytes);
+    }
+}
+
+// writes the tail, the 0x80 marker and the 16 byte bit length into padding and returns how many blocks that
+// took: one, or two when the tail is too long to leave room for the length.
+// the upper half of the 128-bit length only holds the bits shifted out of the byte count.
+static uint32_t sha512_pad (uint8_t padding[256], const uint8_t *tail, uint32_t tail_len, uint64_t data_size_bytes){
+    uint32_t padded_size = 128;
+
+    if (tail_len >= 112){
+        padded_size = 256;
+    }
+    memcpy(padding, tail, tail_len);
+    memset(padding + tail_len, 0x0, padded_size - tail_len);
+    padding[tail_len] = 0x80;
+    store_be64(padding + padded_size - 16, data_size_bytes >> 61);
+    store_be64(padding + padded_size - 8, data_size_bytes * 8);
+    return padded_size / 128;
+}
+
+void sha512_final(sha512_ctx *ctx, uint8_t digest[64]){
+    uint8_t padding[256];
+    uint32_t num_of_blocks;
+    uint64_t start_ns = (ctx->stats != NULL) ? sha_now_ns() : 0;
+
+    num_of_blocks = sha512_pad(padding, ctx->block, ctx->block_len, ctx->data_size_bytes);
+    if (ctx->stats != NULL){
+        ctx->stats->pad_ns += sha_now_ns() - start_ns;
+    }
+    sha512_compress_counted(ctx, padding, num_of_blocks);
+
+    for (uint32_t i = 0; i < 8; i++){
+        store_be64(digest + 8 * i, ctx->hash[i]);
+    }
+}
+
+// the sha512 version of sha256_one_block, for messages up to 111 bytes
+static inline __attribute__((always_inline))
+void sha512_one_block (const uint8_t *data, uint32_t data_size_bytes, uint8_t digest[64]){
+    uint8_t block[128];
+    uint64_t hash[8];
+
+    memcpy(hash, SHA512_INITIAL_HASH_VAL, sizeof(hash));
+    memcpy(block, data, data_size_bytes);
+    block[data_size_bytes] = 0x80;
+    memset(block + data_size_bytes + 1, 0x0, 112 - data_size_bytes - 1);
+    store_be64(block + 112, 0);
+    store_be64(block + 120, (uint64_t) data_size_bytes * 8);
+    sha512_compress_blocks(hash, block, 1);
+    for (uint32_t i = 0; i < 8; i++){
+        store_be64(digest + 8 * i, hash[i]);
+    }
+}
+
+// hashes data into the caller's buffer without allocating
+static inline __attribute__((always_inline))
+void sha512_digest(const uint8_t *data, uint64_t data_size_bytes, uint8_t digest[64]){
+    sha512_ctx ctx;
+
+    if (data_size_bytes <= SHA512_ONE_BLOCK_MAX){
+        sha512_one_block(data, (uint32_t) data_size_bytes, digest);
+        return;
+    }
+    sha512_init(&ctx);
+    sha512_update(&ctx, data, data_size_bytes);
+    sha512_final(&ctx, digest);
+}
+
+#define SHA512_STATE_MAGIC "s512"
+#define SHA512_STATE_VERSION 1
+
+// copies everything absorbed so far into dst, which can then be finished with a different suffix than src;
+// progress reporting and stats are not copied
+void sha512_clone(sha512_ctx *dst, const sha512_ctx *src){
+    *dst = *src;
+    dst->progress.fn = NULL;
+    dst->stats = NULL;
+}
+
+// same layout as the sha256 state with 64-bit hash words and a 128 byte block:
+//     bytes 0-3     magic "s512"
+//     byte  4       format version
+//     bytes 5-7     zero
+//     bytes 8-15    bytes absorbed so far
+//     bytes 16-79   the 8 hash words
+//     bytes 80-207  the unfinished block, zero past its end (its length is the byte count mod 128)
+void sha512_export(const sha512_ctx *ctx, uint8_t state[SHA512_STATE_SIZE]){
+    memset(state, 0, SHA512_STATE_SIZE);
+    memcpy(state, SHA512_STATE_MAGIC, 4);
+    state[4] = SHA512_STATE_VERSION;
+    store_be64(state + 8, ctx->data_size_bytes);
+    for (uint32_t i = 0; i < 8; i++){
+        store_be64(state + 16 + 8 * i, ctx->hash[i]);
+    }
+    memcpy(state + 16 + 64, ctx->block, ctx->block_len);
+}
+
+// returns -1 and leaves ctx alone when the blob is not a sha512 state of this version
+int sha512_import(sha512_ctx *ctx, const uint8_t state[SHA512_STATE_SIZE]){
+    if (memcmp(state, SHA512_STATE_MAGIC, 4) != 0 || state[4] != SHA512_STATE_VERSION){
+        return -1;
+    }
+    sha512_init(ctx);
+    ctx->data_size_bytes = load_be64(state + 8);
+    for (uint32_t i = 0; i < 8; i++){
+        ctx->hash[i] = load_be64(state + 16 + 8 * i);
+    }
+    ctx->block_len = (uint32_t) (ctx->data_size_bytes % 128);
+    memcpy(ctx->block, state + 16 + 64, ctx->block_len);
+    return 0;
+}
+
+uint64_t *sha512(uint8_t *data, uint64_t data_size_bytes){ // returns the 8 64-bit words of the hash
+    uint8_t bytes[64];
+    uint64_t *digest = (uint64_t *) malloc(8 * sizeof(uint64_t));
+
+    if (digest == NULL){
+        return NULL;
+    }
+    sha512_digest(data, data_size_bytes, bytes);
+    for (uint32_t i = 0; i < 8; i++){
+        digest[i] = load_be64(bytes + 8 * i);
+    }
+    return digest;
 }
\ No newline at end of file
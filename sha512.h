@@ -1,8 +1,54 @@
-#ifndef SHA512_H
-#define SHA512_H
-#include <stdint.h>
-#include "sha512.c"
-
-uint64_t *sha512(uint8_t *data, uint64_t data_size_bytes); 
-
+#ifndef SHA512_H
+#define SHA512_H
+#include <stdint.h>
+#include "sha_helpers.h"
+
+// streaming state: the running hash, how many bytes have been absorbed, and the
+// partial block that has not been compressed yet
+typedef struct sha512_ctx {
+    uint64_t hash[8];
+    uint64_t data_size_bytes;
+    uint8_t block[128];
+    uint32_t block_len;
+    sha_progress progress;
+    sha_stats *stats;
+} sha512_ctx;
+
+// compression kernels, SHA512_KERNEL_AUTO picks the fastest one the cpu supports
+enum sha512_kernel {SHA512_KERNEL_AUTO, SHA512_KERNEL_SCALAR, SHA512_KERNEL_AVX2, SHA512_KERNEL_COUNT};
+
+// longest message that still fits in one padded block
+#define SHA512_ONE_BLOCK_MAX 111
+
+// size of an exported context: magic and version, byte count, hash words and the unfinished block
+#define SHA512_STATE_SIZE 208
+
+#include "sha512.c"
+
+void sha512_init(sha512_ctx *ctx);
+
+void sha512_update(sha512_ctx *ctx, const uint8_t *data, uint64_t data_size_bytes);
+
+void sha512_set_progress(sha512_ctx *ctx, sha_progress_fn fn, void *user, uint64_t every_bytes, uint32_t every_ms);
+
+void sha512_set_stats(sha512_ctx *ctx, sha_stats *stats);
+
+void sha512_final(sha512_ctx *ctx, uint8_t digest[64]);
+
+static inline void sha512_digest(const uint8_t *data, uint64_t data_size_bytes, uint8_t digest[64]);
+
+void sha512_clone(sha512_ctx *dst, const sha512_ctx *src);
+
+void sha512_export(const sha512_ctx *ctx, uint8_t state[SHA512_STATE_SIZE]);
+
+int sha512_import(sha512_ctx *ctx, const uint8_t state[SHA512_STATE_SIZE]);
+
+uint64_t *sha512(uint8_t *data, uint64_t data_size_bytes); 
+
+int sha512_set_kernel(enum sha512_kernel kernel);
+
+enum sha512_kernel sha512_get_kernel(void);
+
+const char *sha512_kernel_name(enum sha512_kernel kernel);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,541 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "sha_batch.h"
+#include "sha256.h"
+#include "sha512.h"
+#include "sha_cpu.h"
+#include "sha_helpers.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// the lane kernels keep the state transposed, state[word][lane], so word j of every lane sits in one vector
+// and each lane compresses its own block in the same instruction stream
+typedef void (*sha256_lanes_fn) (uint32_t state[8][SHA_BATCH_MAX_LANES], const uint8_t *blocks[SHA_BATCH_MAX_LANES]);
+typedef void (*sha512_lanes_fn) (uint64_t state[8][SHA_BATCH_MAX_LANES], const uint8_t *blocks[SHA_BATCH_MAX_LANES]);
+
+// one message in flight: the whole blocks are read in place, only the padded tail is copied
+typedef struct sha256_lane {
+    size_t message;
+    const uint8_t *data;
+    uint64_t body_blocks;
+    uint32_t tail_blocks;
+    uint32_t tail_index;
+    uint8_t tail[128];
+} sha256_lane;
+
+typedef struct sha512_lane {
+    size_t message;
+    const uint8_t *data;
+    uint64_t body_blocks;
+    uint32_t tail_blocks;
+    uint32_t tail_index;
+    uint8_t tail[256];
+} sha512_lane;
+
+// fed to lanes that have run out of messages, their result is thrown away
+static const uint8_t SHA_BATCH_IDLE_BLOCK[128] = {0};
+
+//****************************************************************************************************************
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_X8_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define SHA256_X8_XOR3(x, y, z) _mm256_xor_si256(_mm256_xor_si256((x), (y)), (z))
+
+__attribute__((target("avx2")))
+static void sha256_compress_x8_avx2 (uint32_t state[8][SHA_BATCH_MAX_LANES], const uint8_t *blocks[SHA_BATCH_MAX_LANES]){
+    __m256i message[16], working[8], temp1, temp2;
+
+    for (uint32_t i = 0; i < 8; i++){
+        working[i] = _mm256_loadu_si256((const __m256i *) state[i]);
+    }
+    for (uint32_t i = 0; i < 16; i++){
+        message[i] = _mm256_set_epi32((int) load_be32(blocks[7] + 4 * i), (int) load_be32(blocks[6] + 4 * i),
+                                      (int) load_be32(blocks[5] + 4 * i), (int) load_be32(blocks[4] + 4 * i),
+                                      (int) load_be32(blocks[3] + 4 * i), (int) load_be32(blocks[2] + 4 * i),
+                                      (int) load_be32(blocks[1] + 4 * i), (int) load_be32(blocks[0] + 4 * i));
+    }
+
+    for (uint32_t i = 0; i < 64; i++){
+        // the schedule only ever looks 16 words back, so it is kept in a rolling window
+        if (i >= 16){
+            __m256i w2 = message[(i - 2) & 15], w15 = message[(i - 15) & 15];
+            temp1 = SHA256_X8_XOR3(SHA256_X8_ROTR(w2, 17), SHA256_X8_ROTR(w2, 19), _mm256_srli_epi32(w2, 10));
+            temp2 = SHA256_X8_XOR3(SHA256_X8_ROTR(w15, 7), SHA256_X8_ROTR(w15, 18), _mm256_srli_epi32(w15, 3));
+            message[i & 15] = _mm256_add_epi32(_mm256_add_epi32(temp1, message[(i - 7) & 15]),
+                                               _mm256_add_epi32(temp2, message[i & 15]));
+        }
+
+        temp1 = _mm256_add_epi32(working[h], SHA256_X8_XOR3(SHA256_X8_ROTR(working[e], 6), SHA256_X8_ROTR(working[e], 11),
+                                                            SHA256_X8_ROTR(working[e], 25)));
+        temp1 = _mm256_add_epi32(temp1, _mm256_xor_si256(_mm256_and_si256(working[e], working[f]),
+                                                         _mm256_andnot_si256(working[e], working[g])));
+        temp1 = _mm256_add_epi32(temp1, _mm256_add_epi32(_mm256_set1_epi32((int) SHA256_K_CONSTANTS[i]), message[i & 15]));
+        temp2 = _mm256_add_epi32(SHA256_X8_XOR3(SHA256_X8_ROTR(working[a], 2), SHA256_X8_ROTR(working[a], 13),
+                                                SHA256_X8_ROTR(working[a], 22)),
+                                 _mm256_or_si256(_mm256_and_si256(working[a], working[b]),
+                                                 _mm256_and_si256(working[c], _mm256_or_si256(working[a], working[b]))));
+
+        working[h] = working[g];
+        working[g] = working[f];
+        working[f] = working[e];
+        working[e] = _mm256_add_epi32(working[d], temp1);
+        working[d] = working[c];
+        working[c] = working[b];
+        working[b] = working[a];
+        working[a] = _mm256_add_epi32(temp1, temp2);
+    }
+
+    for (uint32_t i = 0; i < 8; i++){
+        temp1 = _mm256_loadu_si256((const __m256i *) state[i]);
+        _mm256_storeu_si256((__m256i *) state[i], _mm256_add_epi32(temp1, working[i]));
+    }
+}
+
+// avx-512 has native rotates, and ternary logic does choice, majority and the 3-way xors in one instruction
+__attribute__((target("avx512f")))
+static void sha256_compress_x16_avx512 (uint32_t state[8][SHA_BATCH_MAX_LANES], const uint8_t *blocks[SHA_BATCH_MAX_LANES]){
+    __m512i message[16], working[8], temp1, temp2;
+
+    for (uint32_t i = 0; i < 8; i++){
+        working[i] = _mm512_loadu_si512((const void *) state[i]);
+    }
+    for (uint32_t i = 0; i < 16; i++){
+        message[i] = _mm512_set_epi32((int) load_be32(blocks[15] + 4 * i), (int) load_be32(blocks[14] + 4 * i),
+                                      (int) load_be32(blocks[13] + 4 * i), (int) load_be32(blocks[12] + 4 * i),
+                                      (int) load_be32(blocks[11] + 4 * i), (int) load_be32(blocks[10] + 4 * i),
+                                      (int) load_be32(blocks[9] + 4 * i), (int) load_be32(blocks[8] + 4 * i),
+                                      (int) load_be32(blocks[7] + 4 * i), (int) load_be32(blocks[6] + 4 * i),
+                                      (int) load_be32(blocks[5] + 4 * i), (int) load_be32(blocks[4] + 4 * i),
+                                      (int) load_be32(blocks[3] + 4 * i), (int) load_be32(blocks[2] + 4 * i),
+                                      (int) load_be32(blocks[1] + 4 * i), (int) load_be32(blocks[0] + 4 * i));
+    }
+
+    for (uint32_t i = 0; i < 64; i++){
+        if (i >= 16){
+            __m512i w2 = message[(i - 2) & 15], w15 = message[(i - 15) & 15];
+            temp1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w2, 17), _mm512_ror_epi32(w2, 19), _mm512_srli_epi32(w2, 10), 0x96);
+            temp2 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w15, 7), _mm512_ror_epi32(w15, 18), _mm512_srli_epi32(w15, 3), 0x96);
+            message[i & 15] = _mm512_add_epi32(_mm512_add_epi32(temp1, message[(i - 7) & 15]),
+                                               _mm512_add_epi32(temp2, message[i & 15]));
+        }
+
+        temp1 = _mm512_add_epi32(working[h], _mm512_ternarylogic_epi32(_mm512_ror_epi32(working[e], 6), _mm512_ror_epi32(working[e], 11),
+                                                                       _mm512_ror_epi32(working[e], 25), 0x96));
+        temp1 = _mm512_add_epi32(temp1, _mm512_ternarylogic_epi32(working[e], working[f], working[g], 0xCA));
+        temp1 = _mm512_add_epi32(temp1, _mm512_add_epi32(_mm512_set1_epi32((int) SHA256_K_CONSTANTS[i]), message[i & 15]));
+        temp2 = _mm512_add_epi32(_mm512_ternarylogic_epi32(_mm512_ror_epi32(working[a], 2), _mm512_ror_epi32(working[a], 13),
+                                                           _mm512_ror_epi32(working[a], 22), 0x96),
+                                 _mm512_ternarylogic_epi32(working[a], working[b], working[c], 0xE8));
+
+        working[h] = working[g];
+        working[g] = working[f];
+        working[f] = working[e];
+        working[e] = _mm512_add_epi32(working[d], temp1);
+        working[d] = working[c];
+        working[c] = working[b];
+        working[b] = working[a];
+        working[a] = _mm512_add_epi32(temp1, temp2);
+    }
+
+    for (uint32_t i = 0; i < 8; i++){
+        temp1 = _mm512_loadu_si512((const void *) state[i]);
+        _mm512_storeu_si512((void *) state[i], _mm512_add_epi32(temp1, working[i]));
+    }
+}
+
+#define SHA512_X4_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+#define SHA512_X4_XOR3(x, y, z) _mm256_xor_si256(_mm256_xor_si256((x), (y)), (z))
+
+__attribute__((target("avx2")))
+static void sha512_compress_x4_avx2 (uint64_t state[8][SHA_BATCH_MAX_LANES], const uint8_t *blocks[SHA_BATCH_MAX_LANES]){
+    __m256i message[16], working[8], temp1, temp2;
+
+    for (uint32_t i = 0; i < 8; i++){
+        working[i] = _mm256_loadu_si256((const __m256i *) state[i]);
+    }
+    for (uint32_t i = 0; i < 16; i++){
+        message[i] = _mm256_set_epi64x((long long) load_be64(blocks[3] + 8 * i), (long long) load_be64(blocks[2] + 8 * i),
+                                       (long long) load_be64(blocks[1] + 8 * i), (long long) load_be64(blocks[0] + 8 * i));
+    }
+
+    for (uint32_t i = 0; i < 80; i++){
+        if (i >= 16){
+            __m256i w2 = message[(i - 2) & 15], w15 = message[(i - 15) & 15];
+            temp1 = SHA512_X4_XOR3(SHA512_X4_ROTR(w2, 19), SHA512_X4_ROTR(w2, 61), _mm256_srli_epi64(w2, 6));
+            temp2 = SHA512_X4_XOR3(SHA512_X4_ROTR(w15, 1), SHA512_X4_ROTR(w15, 8), _mm256_srli_epi64(w15, 7));
+            message[i & 15] = _mm256_add_epi64(_mm256_add_epi64(temp1, message[(i - 7) & 15]),
+                                               _mm256_add_epi64(temp2, message[i & 15]));
+        }
+
+        temp1 = _mm256_add_epi64(working[h], SHA512_X4_XOR3(SHA512_X4_ROTR(working[e], 14), SHA512_X4_ROTR(working[e], 18),
+                                                            SHA512_X4_ROTR(working[e], 41)));
+        temp1 = _mm256_add_epi64(temp1, _mm256_xor_si256(_mm256_and_si256(working[e], working[f]),
+                                                         _mm256_andnot_si256(working[e], working[g])));
+        temp1 = _mm256_add_epi64(temp1, _mm256_add_epi64(_mm256_set1_epi64x((long long) SHA512_K_CONSTANTS[i]), message[i & 15]));
+        temp2 = _mm256_add_epi64(SHA512_X4_XOR3(SHA512_X4_ROTR(working[a], 28), SHA512_X4_ROTR(working[a], 34),
+                                                SHA512_X4_ROTR(working[a], 39)),
+                                 _mm256_or_si256(_mm256_and_si256(working[a], working[b]),
+                                                 _mm256_and_si256(working[c], _mm256_or_si256(working[a], working[b]))));
+
+        working[h] = working[g];
+        working[g] = working[f];
+        working[f] = working[e];
+        working[e] = _mm256_add_epi64(working[d], temp1);
+        working[d] = working[c];
+        working[c] = working[b];
+        working[b] = working[a];
+        working[a] = _mm256_add_epi64(temp1, temp2);
+    }
+
+    for (uint32_t i = 0; i < 8; i++){
+        temp1 = _mm256_loadu_si256((const __m256i *) state[i]);
+        _mm256_storeu_si256((__m256i *) state[i], _mm256_add_epi64(temp1, working[i]));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void sha512_compress_x8_avx512 (uint64_t state[8][SHA_BATCH_MAX_LANES], const uint8_t *blocks[SHA_BATCH_MAX_LANES]){
+    __m512i message[16], working[8], temp1, temp2;
+
+    for (uint32_t i = 0; i < 8; i++){
+        working[i] = _mm512_loadu_si512((const void *) state[i]);
+    }
+    for (uint32_t i = 0; i < 16; i++){
+        message[i] = _mm512_set_epi64((long long) load_be64(blocks[7] + 8 * i), (long long) load_be64(blocks[6] + 8 * i),
+                                      (long long) load_be64(blocks[5] + 8 * i), (long long) load_be64(blocks[4] + 8 * i),
+                                      (long long) load_be64(blocks[3] + 8 * i), (long long) load_be64(blocks[2] + 8 * i),
+                                      (long long) load_be64(blocks[1] + 8 * i), (long long) load_be64(blocks[0] + 8 * i));
+    }
+
+    for (uint32_t i = 0; i < 80; i++){
+        if (i >= 16){
+            __m512i w2 = message[(i - 2) & 15], w15 = message[(i - 15) & 15];
+            temp1 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(w2, 19), _mm512_ror_epi64(w2, 61), _mm512_srli_epi64(w2, 6), 0x96);
+            temp2 = _mm512_ternarylogic_epi64(_mm512_ror_epi64(w15, 1), _mm512_ror_epi64(w15, 8), _mm512_srli_epi64(w15, 7), 0x96);
+            message[i & 15] = _mm512_add_epi64(_mm512_add_epi64(temp1, message[(i - 7) & 15]),
+                                               _mm512_add_epi64(temp2, message[i & 15]));
+        }
+
+        temp1 = _mm512_add_epi64(working[h], _mm512_ternarylogic_epi64(_mm512_ror_epi64(working[e], 14), _mm512_ror_epi64(working[e], 18),
+                                                                       _mm512_ror_epi64(working[e], 41), 0x96));
+        temp1 = _mm512_add_epi64(temp1, _mm512_ternarylogic_epi64(working[e], working[f], working[g], 0xCA));
+        temp1 = _mm512_add_epi64(temp1, _mm512_add_epi64(_mm512_set1_epi64((long long) SHA512_K_CONSTANTS[i]), message[i & 15]));
+        temp2 = _mm512_add_epi64(_mm512_ternarylogic_epi64(_mm512_ror_epi64(working[a], 28), _mm512_ror_epi64(working[a], 34),
+                                                           _mm512_ror_epi64(working[a], 39), 0x96),
+                                 _mm512_ternarylogic_epi64(working[a], working[b], working[c], 0xE8));
+
+        working[h] = working[g];
+        working[g] = working[f];
+        working[f] = working[e];
+        working[e] = _mm512_add_epi64(working[d], temp1);
+        working[d] = working[c];
+        working[c] = working[b];
+        working[b] = working[a];
+        working[a] = _mm512_add_epi64(temp1, temp2);
+    }
+
+    for (uint32_t i = 0; i < 8; i++){
+        temp1 = _mm512_loadu_si512((const void *) state[i]);
+        _mm512_storeu_si512((void *) state[i], _mm512_add_epi64(temp1, working[i]));
+    }
+}
+#endif
+
+//****************************************************************************************************************
+
+static void sha256_lane_start (sha256_lane *lane, uint32_t state[8][SHA_BATCH_MAX_LANES], uint32_t lane_index,
+                               const uint32_t initial[8], uint64_t prefix_bytes,
+                               size_t message, const uint8_t *data, size_t data_size_bytes){
+    lane->message = message;
+    lane->data = data;
+    lane->body_blocks = data_size_bytes / 64;
+    lane->tail_blocks = sha256_pad(lane->tail, data + (data_size_bytes - data_size_bytes % 64),
+                                   data_size_bytes % 64, prefix_bytes + data_size_bytes);
+    lane->tail_index = 0;
+    for (uint32_t i = 0; i < 8; i++){
+        state[i][lane_index] = initial[i];
+    }
+}
+
+// every lane works through its own message block by block; when one finishes, its digest is written out and the
+// next message takes over the lane, so messages of different lengths never hold up the group.
+// lanes start from `initial` as if prefix_bytes (a multiple of the block size) had already been compressed.
+static void sha256_batch_lanes (const uint32_t initial[8], uint64_t prefix_bytes, const uint8_t **msgs, const size_t *lens,
+                                size_t n, uint8_t (*out)[32], uint32_t lanes, sha256_lanes_fn compress){
+    sha256_lane lane[SHA_BATCH_MAX_LANES];
+    uint32_t state[8][SHA_BATCH_MAX_LANES];
+    const uint8_t *blocks[SHA_BATCH_MAX_LANES];
+    size_t next = 0;
+    uint32_t active = 0;
+
+    for (uint32_t l = 0; l < lanes; l++){
+        if (next < n){
+            sha256_lane_start(&lane[l], state, l, initial, prefix_bytes, next, msgs[next], lens[next]);
+            next++;
+            active++;
+        } else {
+            lane[l].message = SIZE_MAX;
+        }
+    }
+
+    while (active > 0){
+        for (uint32_t l = 0; l < lanes; l++){
+            if (lane[l].message == SIZE_MAX){
+                blocks[l] = SHA_BATCH_IDLE_BLOCK;
+            } else if (lane[l].body_blocks > 0){
+                blocks[l] = lane[l].data;
+            } else {
+                blocks[l] = lane[l].tail + 64 * lane[l].tail_index;
+            }
+        }
+        compress(state, blocks);
+
+        for (uint32_t l = 0; l < lanes; l++){
+            if (lane[l].message == SIZE_MAX){
+                continue;
+            }
+            if (lane[l].body_blocks > 0){
+                lane[l].data += 64;
+                lane[l].body_blocks--;
+                continue;
+            }
+            if (++lane[l].tail_index < lane[l].tail_blocks){
+                continue;
+            }
+            for (uint32_t i = 0; i < 8; i++){
+                store_be32(out[lane[l].message] + 4 * i, state[i][l]);
+            }
+            if (next < n){
+                sha256_lane_start(&lane[l], state, l, initial, prefix_bytes, next, msgs[next], lens[next]);
+                next++;
+            } else {
+                lane[l].message = SIZE_MAX;
+                active--;
+            }
+        }
+    }
+}
+
+static void sha512_lane_start (sha512_lane *lane, uint64_t state[8][SHA_BATCH_MAX_LANES], uint32_t lane_index,
+                               const uint64_t initial[8], uint64_t prefix_bytes,
+                               size_t message, const uint8_t *data, size_t data_size_bytes){
+    lane->message = message;
+    lane->data = data;
+    lane->body_blocks = data_size_bytes / 128;
+    lane->tail_blocks = sha512_pad(lane->tail, data + (data_size_bytes - data_size_bytes % 128),
+                                   data_size_bytes % 128, prefix_bytes + data_size_bytes);
+    lane->tail_index = 0;
+    for (uint32_t i = 0; i < 8; i++){
+        state[i][lane_index] = initial[i];
+    }
+}
+
+static void sha512_batch_lanes (const uint64_t initial[8], uint64_t prefix_bytes, const uint8_t **msgs, const size_t *lens,
+                                size_t n, uint8_t (*out)[64], uint32_t lanes, sha512_lanes_fn compress){
+    sha512_lane lane[SHA_BATCH_MAX_LANES];
+    uint64_t state[8][SHA_BATCH_MAX_LANES];
+    const uint8_t *blocks[SHA_BATCH_MAX_LANES];
+    size_t next = 0;
+    uint32_t active = 0;
+
+    for (uint32_t l = 0; l < lanes; l++){
+        if (next < n){
+            sha512_lane_start(&lane[l], state, l, initial, prefix_bytes, next, msgs[next], lens[next]);
+            next++;
+            active++;
+        } else {
+            lane[l].message = SIZE_MAX;
+        }
+    }
+
+    while (active > 0){
+        for (uint32_t l = 0; l < lanes; l++){
+            if (lane[l].message == SIZE_MAX){
+                blocks[l] = SHA_BATCH_IDLE_BLOCK;
+            } else if (lane[l].body_blocks > 0){
+                blocks[l] = lane[l].data;
+            } else {
+                blocks[l] = lane[l].tail + 128 * lane[l].tail_index;
+            }
+        }
+        compress(state, blocks);
+
+        for (uint32_t l = 0; l < lanes; l++){
+            if (lane[l].message == SIZE_MAX){
+                continue;
+            }
+            if (lane[l].body_blocks > 0){
+                lane[l].data += 128;
+                lane[l].body_blocks--;
+                continue;
+            }
+            if (++lane[l].tail_index < lane[l].tail_blocks){
+                continue;
+            }
+            for (uint32_t i = 0; i < 8; i++){
+                store_be64(out[lane[l].message] + 8 * i, state[i][l]);
+            }
+            if (next < n){
+                sha512_lane_start(&lane[l], state, l, initial, prefix_bytes, next, msgs[next], lens[next]);
+                next++;
+            } else {
+                lane[l].message = SIZE_MAX;
+                active--;
+            }
+        }
+    }
+}
+
+//****************************************************************************************************************
+
+static enum sha_batch_kernel sha256_batch_active_kernel = SHA_BATCH_KERNEL_LOOP;
+static enum sha_batch_kernel sha512_batch_active_kernel = SHA_BATCH_KERNEL_LOOP;
+
+static const char *SHA_BATCH_KERNEL_NAMES[SHA_BATCH_KERNEL_COUNT] = {"auto", "loop", "avx2", "avx512"};
+
+const char *sha_batch_kernel_name(enum sha_batch_kernel kernel){
+    if (kernel >= SHA_BATCH_KERNEL_COUNT){
+        return "unknown";
+    }
+    return SHA_BATCH_KERNEL_NAMES[kernel];
+}
+
+enum sha_batch_kernel sha256_batch_get_kernel(void){
+    return sha256_batch_active_kernel;
+}
+
+enum sha_batch_kernel sha512_batch_get_kernel(void){
+    return sha512_batch_active_kernel;
+}
+
+// returns -1 and keeps the current kernels when the cpu does not support the requested one.
+// auto is resolved per algorithm: 8 avx2 lanes are slower than one sha-ni stream, so sha256 only goes wide with
+// avx-512 when the cpu has sha-ni, while sha512 has no hardware rounds and always takes the widest lanes.
+int sha_batch_set_kernel(enum sha_batch_kernel kernel){
+    uint32_t features = sha_cpu_features();
+    enum sha_batch_kernel widest = SHA_BATCH_KERNEL_LOOP;
+
+    if (features & SHA_CPU_AVX512){
+        widest = SHA_BATCH_KERNEL_AVX512;
+    } else if (features & SHA_CPU_AVX2){
+        widest = SHA_BATCH_KERNEL_AVX2;
+    }
+
+    if (kernel == SHA_BATCH_KERNEL_AUTO){
+        sha512_batch_active_kernel = widest;
+        sha256_batch_active_kernel = widest;
+        if (widest == SHA_BATCH_KERNEL_AVX2 && (features & SHA_CPU_SHA)){
+            sha256_batch_active_kernel = SHA_BATCH_KERNEL_LOOP;
+        }
+        return 0;
+    }
+    if ((kernel == SHA_BATCH_KERNEL_AVX2 && !(features & SHA_CPU_AVX2)) ||
+        (kernel == SHA_BATCH_KERNEL_AVX512 && !(features & SHA_CPU_AVX512)) ||
+        kernel >= SHA_BATCH_KERNEL_COUNT){
+        return -1;
+    }
+    sha256_batch_active_kernel = kernel;
+    sha512_batch_active_kernel = kernel;
+    return 0;
+}
+
+// runs before main, SHA_BATCH_KERNEL=<name> in the environment forces a kernel for testing
+__attribute__((constructor))
+static void sha_batch_select_kernel (void){
+    const char *forced = getenv("SHA_BATCH_KERNEL");
+
+    if (forced != NULL){
+        for (uint32_t kernel = 0; kernel < SHA_BATCH_KERNEL_COUNT; kernel++){
+            if (strcmp(forced, SHA_BATCH_KERNEL_NAMES[kernel]) == 0 && sha_batch_set_kernel(kernel) == 0){
+                return;
+            }
+        }
+        fprintf(stderr, "Warning: SHA_BATCH_KERNEL=%s is not available, using auto\n", forced);
+    }
+    sha_batch_set_kernel(SHA_BATCH_KERNEL_AUTO);
+}
+
+// the lane kernel behind the batch api and its width, 0 lanes when the active kernel takes messages one by one
+static uint32_t sha256_batch_lane_kernel (sha256_lanes_fn *compress){
+    switch (sha256_batch_active_kernel){
+#if defined(__x86_64__) || defined(__i386__)
+        case SHA_BATCH_KERNEL_AVX512:
+            *compress = sha256_compress_x16_avx512;
+            return 16;
+        case SHA_BATCH_KERNEL_AVX2:
+            *compress = sha256_compress_x8_avx2;
+            return 8;
+#endif
+        default:
+            return 0;
+    }
+}
+
+static uint32_t sha512_batch_lane_kernel (sha512_lanes_fn *compress){
+    switch (sha512_batch_active_kernel){
+#if defined(__x86_64__) || defined(__i386__)
+        case SHA_BATCH_KERNEL_AVX512:
+            *compress = sha512_compress_x8_avx512;
+            return 8;
+        case SHA_BATCH_KERNEL_AVX2:
+            *compress = sha512_compress_x4_avx2;
+            return 4;
+#endif
+        default:
+            return 0;
+    }
+}
+
+// continues n messages from one midstate, as left by compressing prefix_bytes bytes (a whole number of blocks);
+// hmac uses it to start every message from the keyed inner and outer states
+static void sha256_batch_from (const uint32_t initial[8], uint64_t prefix_bytes, const uint8_t **msgs,
+                               const size_t *lens, size_t n, uint8_t (*out)[32]){
+    sha256_lanes_fn compress;
+    uint32_t lanes = sha256_batch_lane_kernel(&compress);
+    sha256_ctx ctx;
+
+    if (lanes > 0){
+        sha256_batch_lanes(initial, prefix_bytes, msgs, lens, n, out, lanes, compress);
+        return;
+    }
+    for (size_t i = 0; i < n; i++){
+        sha256_init(&ctx);
+        memcpy(ctx.hash, initial, sizeof(ctx.hash));
+        ctx.data_size_bytes = prefix_bytes;
+        sha256_update(&ctx, msgs[i], lens[i]);
+        sha256_final(&ctx, out[i]);
+    }
+}
+
+static void sha512_batch_from (const uint64_t initial[8], uint64_t prefix_bytes, const uint8_t **msgs,
+                               const size_t *lens, size_t n, uint8_t (*out)[64]){
+    sha512_lanes_fn compress;
+    uint32_t lanes = sha512_batch_lane_kernel(&compress);
+    sha512_ctx ctx;
+
+    if (lanes > 0){
+        sha512_batch_lanes(initial, prefix_bytes, msgs, lens, n, out, lanes, compress);
+        return;
+    }
+    for (size_t i = 0; i < n; i++){
+        sha512_init(&ctx);
+        memcpy(ctx.hash, initial, sizeof(ctx.hash));
+        ctx.data_size_bytes = prefix_bytes;
+        sha512_update(&ctx, msgs[i], lens[i]);
+        sha512_final(&ctx, out[i]);
+    }
+}
+
+// hashes n independent messages, out[i] receives the digest of msgs[i]
+void sha256_batch(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[32]){
+    sha256_batch_from(SHA256_INITIAL_HASH_VAL, 0, msgs, lens, n, out);
+}
+
+void sha512_batch(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[64]){
+    sha512_batch_from(SHA512_INITIAL_HASH_VAL, 0, msgs, lens, n, out);
+}
\ No newline at end of file
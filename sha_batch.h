@@ -0,0 +1,26 @@
+#ifndef SHA_BATCH_H
+#define SHA_BATCH_H
+#include <stdint.h>
+#include <stddef.h>
+
+// widest lane group any kernel uses (16 sha256 lanes with avx-512)
+#define SHA_BATCH_MAX_LANES 16
+
+// multi-buffer kernels, SHA_BATCH_KERNEL_LOOP hashes the messages one after another with the single-buffer kernel
+enum sha_batch_kernel {SHA_BATCH_KERNEL_AUTO, SHA_BATCH_KERNEL_LOOP, SHA_BATCH_KERNEL_AVX2, SHA_BATCH_KERNEL_AVX512, SHA_BATCH_KERNEL_COUNT};
+
+#include "sha_batch.c"
+
+void sha256_batch(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[32]);
+
+void sha512_batch(const uint8_t **msgs, const size_t *lens, size_t n, uint8_t (*out)[64]);
+
+int sha_batch_set_kernel(enum sha_batch_kernel kernel);
+
+enum sha_batch_kernel sha256_batch_get_kernel(void);
+
+enum sha_batch_kernel sha512_batch_get_kernel(void);
+
+const char *sha_batch_kernel_name(enum sha_batch_kernel kernel);
+
+#endif
\ No newline at end of file
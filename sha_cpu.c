@@ -0,0 +1,49 @@
+#include <stdint.h>
+#include "sha_cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+// asks the cpu once which instruction set extensions the hashing kernels can use
+uint32_t sha_cpu_features (void){
+    static int detected = 0;
+    static uint32_t features = 0;
+
+    if (detected){
+        return features;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t sse41 = 0, osxsave = 0;
+    uint64_t xcr0 = 0;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)){
+        sse41 = (ecx >> 19) & 1;
+        osxsave = (ecx >> 27) & 1;
+    }
+    // the vector registers are only usable when the os saves them on context switches
+    if (osxsave){
+        uint32_t xcr0_low, xcr0_high;
+        __asm__ ("xgetbv" : "=a" (xcr0_low), "=d" (xcr0_high) : "c" (0));
+        xcr0 = ((uint64_t) xcr0_high << 32) | xcr0_low;
+    }
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)){
+        // the sha rounds also need sse4.1 for the state shuffles
+        if (((ebx >> 29) & 1) && sse41){
+            features |= SHA_CPU_SHA;
+        }
+        if (((ebx >> 5) & 1) && (xcr0 & 0x06) == 0x06){
+            features |= SHA_CPU_AVX2;
+        }
+        if (((ebx >> 16) & 1) && (xcr0 & 0xE6) == 0xE6){
+            features |= SHA_CPU_AVX512;
+        }
+        if ((ebx >> 8) & 1){
+            features |= SHA_CPU_BMI2;
+        }
+    }
+#endif
+    detected = 1;
+    return features;
+}
\ No newline at end of file
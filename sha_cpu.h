@@ -0,0 +1,15 @@
+#ifndef SHA_CPU_H
+#define SHA_CPU_H
+#include <stdint.h>
+
+// feature bits returned by sha_cpu_features
+#define SHA_CPU_SHA (1u << 0)
+#define SHA_CPU_AVX2 (1u << 1)
+#define SHA_CPU_AVX512 (1u << 2)
+#define SHA_CPU_BMI2 (1u << 3)
+
+#include "sha_cpu.c"
+
+uint32_t sha_cpu_features (void);
+
+#endif
\ No newline at end of file
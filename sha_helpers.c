@@ -1,42 +1,135 @@
-#include <stdint.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include "sha_helpers.h"
-
-void print_progress_bar (uint64_t progress, uint64_t bar_size, uint64_t min, uint64_t max){
-    if (min == max){
-        return;
-    }
-    uint32_t bar_pos = (uint32_t) (((uint64_t) bar_size * (progress - min)) / (max - min));
-    float percent = 100.0 * ((float) (progress - min) / (float)(max - min));
-
-    fputs("\r[", stdout);
-    for (unsigned int i = 0; i < bar_size; i++){
-        if (i < bar_pos){
-            fputc('=', stdout);
-        } else {
-            fputc('-', stdout);
-        }
-    }
-    if (progress > (max - 1500)){
-        percent = 100.0;
-    }
-    printf("] %.3f %%", percent);
-    fflush(stdout);
-}
-
-uint32_t ceil_divide (uint32_t num, uint32_t denum){
-    if (num % denum){
-        return 1 + (num / denum);
-    } else {
-        return num / denum;
-    }
-}
-
-uint32_t majority (uint32_t x, uint32_t y, uint32_t z){
-    return (x & y) ^ (x & z) ^ (y & z);
-}
-
-uint32_t choice (uint32_t x, uint32_t y, uint32_t z){
-    return (x & y) ^ ((~x) & z);
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include "sha_helpers.h"
+
+uint64_t ceil_divide (uint64_t num, uint64_t denum){
+    if (num % denum){
+        return 1 + (num / denum);
+    } else {
+        return num / denum;
+    }
+}
+
+// gcc and clang turn this pattern into a single ror, the mask keeps n == 0 defined
+static inline uint32_t rotr32 (uint32_t x, uint32_t n){
+    return (x >> n) | (x << ((32 - n) & 31));
+}
+
+static inline uint64_t rotr64 (uint64_t x, uint32_t n){
+    return (x >> n) | (x << ((64 - n) & 63));
+}
+
+// big-endian word loads and stores, one word at a time straight from/to the caller's buffer
+static inline uint32_t load_be32 (const uint8_t *bytes){
+    uint32_t word;
+    memcpy(&word, bytes, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap32(word);
+#endif
+    return word;
+}
+
+static inline uint64_t load_be64 (const uint8_t *bytes){
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+static inline void store_be32 (uint8_t *bytes, uint32_t word){
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap32(word);
+#endif
+    memcpy(bytes, &word, sizeof(word));
+}
+
+static inline void store_be64 (uint8_t *bytes, uint64_t word){
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    memcpy(bytes, &word, sizeof(word));
+}
+
+// compares two digests without an early exit, so the time taken says nothing about where they differ
+static inline int sha_digest_equal (const uint8_t *x, const uint8_t *y, uint32_t size){
+    volatile uint8_t difference = 0;
+
+    for (uint32_t i = 0; i < size; i++){
+        difference |= x[i] ^ y[i];
+    }
+    return difference == 0;
+}
+
+// clears key material; the volatile stores cannot be dropped as dead stores the way a memset before return can
+static inline void sha_wipe (void *data, size_t size){
+    volatile uint8_t *bytes = (volatile uint8_t *) data;
+
+    while (size-- > 0){
+        *bytes++ = 0;
+    }
+}
+
+static uint64_t sha_now_ns (void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+// the time stamp counter ticks at a fixed reference rate, close to but not always the core clock.
+// other architectures have no portable counter and report 0 cycles
+static inline uint64_t sha_now_cycles (void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// stats == NULL costs one predictable branch per compress call and nothing else
+static inline void sha_stats_compressed (sha_stats *stats, uint64_t num_of_blocks, uint64_t start_ns, uint64_t start_cycles){
+    stats->blocks += num_of_blocks;
+    stats->compress_cycles += sha_now_cycles() - start_cycles;
+    stats->compress_ns += sha_now_ns() - start_ns;
+}
+
+// every_bytes or every_ms may be 0 to only use the other limit, fn == NULL turns reporting off
+static void sha_progress_set (sha_progress *progress, sha_progress_fn fn, void *user, uint64_t every_bytes, uint32_t every_ms){
+    progress->fn = fn;
+    progress->user = user;
+    progress->every_bytes = every_bytes;
+    progress->every_ns = (uint64_t) every_ms * 1000000ULL;
+    progress->next_bytes = every_bytes;
+    progress->last_ns = (fn != NULL && every_ms > 0) ? sha_now_ns() : 0;
+}
+
+// called between slices of an update, the clock is only read when a time limit is set
+static void sha_progress_report (sha_progress *progress, uint64_t bytes_hashed){
+    int due = 0;
+
+    if (progress->every_bytes > 0 && bytes_hashed >= progress->next_bytes){
+        due = 1;
+    }
+    if (!due && progress->every_ns > 0 && sha_now_ns() - progress->last_ns >= progress->every_ns){
+        due = 1;
+    }
+    if (!due){
+        return;
+    }
+    progress->next_bytes = bytes_hashed + progress->every_bytes;
+    if (progress->every_ns > 0){
+        progress->last_ns = sha_now_ns();
+    }
+    progress->fn(progress->user, bytes_hashed);
+}
+
+// how much an update hashes between two progress checks
+static uint64_t sha_progress_slice (const sha_progress *progress){
+    if (progress->every_bytes > 0 && progress->every_bytes < SHA_PROGRESS_MAX_SLICE){
+        return progress->every_bytes;
+    }
+    return SHA_PROGRESS_MAX_SLICE;
 }
\ No newline at end of file
@@ -1,16 +1,64 @@
-#ifndef SHA_HELPERS_H
-#define SHA_HELPERS_H
-#include <stdint.h>
-#include "sha_helpers.c"
-
-enum temp_hash {a, b, c, d, e, f, g, h};
-
-void print_progress_bar (uint64_t progress, uint64_t bar_size, uint64_t min, uint64_t max);
-
-uint32_t ceil_divide (uint32_t num, uint32_t denum);
-
-uint32_t majority (uint32_t x, uint32_t y, uint32_t z);
-
-uint32_t choice (uint32_t x, uint32_t y, uint32_t z);
-
+#ifndef SHA_HELPERS_H
+#define SHA_HELPERS_H
+#include <stdint.h>
+#include <stddef.h>
+
+// optional progress reporting for the streaming contexts, see sha256_set_progress/sha512_set_progress
+typedef void (*sha_progress_fn) (void *user, uint64_t bytes_hashed);
+
+typedef struct sha_progress {
+    sha_progress_fn fn;
+    void *user;
+    uint64_t every_bytes;
+    uint64_t every_ns;
+    uint64_t next_bytes;
+    uint64_t last_ns;
+} sha_progress;
+
+// optional counters for one context, see sha256_set_stats/sha512_set_stats. the context only ever writes to the
+// struct it was given, so contexts on different threads share nothing. blocks counts every compressed block,
+// padding included; copied_bytes is what had to be buffered in the context because it did not fill a whole block
+typedef struct sha_stats {
+    const char *kernel;
+    uint64_t bytes;
+    uint64_t blocks;
+    uint64_t copied_bytes;
+    uint64_t pad_ns;
+    uint64_t compress_ns;
+    uint64_t compress_cycles;
+} sha_stats;
+
+// with a callback set, long updates are split into slices of at most this size so reports keep coming
+#define SHA_PROGRESS_MAX_SLICE (1 << 20)
+
+#include "sha_helpers.c"
+
+enum temp_hash {a, b, c, d, e, f, g, h};
+
+uint64_t ceil_divide (uint64_t num, uint64_t denum);
+
+static inline uint32_t load_be32 (const uint8_t *bytes);
+
+static inline uint64_t load_be64 (const uint8_t *bytes);
+
+static inline void store_be32 (uint8_t *bytes, uint32_t word);
+
+static inline void store_be64 (uint8_t *bytes, uint64_t word);
+
+static inline int sha_digest_equal (const uint8_t *x, const uint8_t *y, uint32_t size);
+
+static inline void sha_wipe (void *data, size_t size);
+
+static uint64_t sha_now_ns (void);
+
+static inline uint64_t sha_now_cycles (void);
+
+static inline void sha_stats_compressed (sha_stats *stats, uint64_t num_of_blocks, uint64_t start_ns, uint64_t start_cycles);
+
+static void sha_progress_set (sha_progress *progress, sha_progress_fn fn, void *user, uint64_t every_bytes, uint32_t every_ms);
+
+static void sha_progress_report (sha_progress *progress, uint64_t bytes_hashed);
+
+static uint64_t sha_progress_slice (const sha_progress *progress);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sha_io.h"
+
+// two buffers handed back and forth between the reader thread and the hashing thread,
+// so the next read is already in flight while the previous buffer is being compressed
+typedef struct sha_io_pipeline {
+    int fd;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    uint8_t *buffers[2];
+    uint64_t sizes[2];
+    int full[2];
+    int finished;
+    int error;
+    int stop;
+} sha_io_pipeline;
+
+static void *sha_io_reader (void *arg){
+    sha_io_pipeline *pipeline = (sha_io_pipeline *) arg;
+    uint32_t current = 0;
+
+    for (;;){
+        uint64_t filled = 0;
+        int eof = 0, error = 0;
+
+        pthread_mutex_lock(&pipeline->lock);
+        while (pipeline->full[current] && !pipeline->stop){
+            pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+        }
+        if (pipeline->stop){
+            pthread_mutex_unlock(&pipeline->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+
+        // pipes hand out at most a page or so per read, keep reading until the buffer is worth handing over
+        while (filled < SHA_IO_BUFFER_SIZE){
+            ssize_t bytes_read = read(pipeline->fd, pipeline->buffers[current] + filled, SHA_IO_BUFFER_SIZE - filled);
+            if (bytes_read < 0 && errno == EINTR){
+                continue;
+            }
+            if (bytes_read <= 0){
+                eof = 1;
+                error = (bytes_read < 0) ? errno : 0;
+                break;
+            }
+            filled += (uint64_t) bytes_read;
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->sizes[current] = filled;
+        pipeline->full[current] = 1;
+        if (eof){
+            pipeline->finished = 1;
+            pipeline->error = error;
+        }
+        pthread_cond_broadcast(&pipeline->changed);
+        pthread_mutex_unlock(&pipeline->lock);
+
+        if (eof){
+            break;
+        }
+        current ^= 1;
+    }
+    return NULL;
+}
+
+// reads anything that cannot be mapped (pipes, stdin, sockets, devices) on a second thread
+static int sha_io_read_pipelined (int fd, sha_io_consumer consume, void *user){
+    sha_io_pipeline pipeline;
+    pthread_t reader;
+    uint32_t current = 0;
+    int result = 0;
+
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.fd = fd;
+    pipeline.buffers[0] = (uint8_t *) malloc(2 * (size_t) SHA_IO_BUFFER_SIZE);
+    if (pipeline.buffers[0] == NULL){
+        return -1;
+    }
+    pipeline.buffers[1] = pipeline.buffers[0] + SHA_IO_BUFFER_SIZE;
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.changed, NULL);
+    if (pthread_create(&reader, NULL, sha_io_reader, &pipeline) != 0){
+        free(pipeline.buffers[0]);
+        return -1;
+    }
+
+    for (;;){
+        pthread_mutex_lock(&pipeline.lock);
+        while (!pipeline.full[current] && !pipeline.finished){
+            pthread_cond_wait(&pipeline.changed, &pipeline.lock);
+        }
+        if (!pipeline.full[current]){
+            pthread_mutex_unlock(&pipeline.lock);
+            break;
+        }
+        pthread_mutex_unlock(&pipeline.lock);
+
+        if (pipeline.sizes[current] > 0 && consume(user, pipeline.buffers[current], pipeline.sizes[current]) != 0){
+            result = -1;
+        }
+
+        pthread_mutex_lock(&pipeline.lock);
+        pipeline.full[current] = 0;
+        if (result != 0){
+            pipeline.stop = 1;
+        }
+        pthread_cond_broadcast(&pipeline.changed);
+        pthread_mutex_unlock(&pipeline.lock);
+        if (result != 0){
+            break;
+        }
+        current ^= 1;
+    }
+
+    pthread_join(reader, NULL);
+    if (pipeline.error != 0){
+        errno = pipeline.error;
+        result = -1;
+    }
+    pthread_mutex_destroy(&pipeline.lock);
+    pthread_cond_destroy(&pipeline.changed);
+    free(pipeline.buffers[0]);
+    return result;
+}
+
+// regular files are mapped a window at a time and handed over without a single copy;
+// returns 1 when the file cannot be mapped so the caller can fall back to reading it
+static int sha_io_read_mapped (int fd, uint64_t file_size, sha_io_consumer consume, void *user){
+    for (uint64_t offset = 0; offset < file_size; offset += SHA_IO_MAP_WINDOW){
+        uint64_t window = file_size - offset;
+        uint8_t *data;
+        int result;
+
+        if (window > SHA_IO_MAP_WINDOW){
+            window = SHA_IO_MAP_WINDOW;
+        }
+        data = (uint8_t *) mmap(NULL, (size_t) window, PROT_READ, MAP_PRIVATE, fd, (off_t) offset);
+        if (data == MAP_FAILED){
+            return (offset == 0) ? 1 : -1;
+        }
+        madvise(data, (size_t) window, MADV_SEQUENTIAL);
+        result = consume(user, data, window);
+        munmap(data, (size_t) window);
+        if (result != 0){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// feeds everything fd holds to consume, returns 0 on success and -1 on a read error or when consume gave up
+int sha_io_read_fd (int fd, sha_io_consumer consume, void *user){
+    struct stat file_status;
+
+    if (fstat(fd, &file_status) == 0 && S_ISREG(file_status.st_mode) && file_status.st_size > 0){
+        off_t position = lseek(fd, 0, SEEK_CUR);
+        // a redirected stdin may already be part way through the file
+        if (position == 0){
+            int result = sha_io_read_mapped(fd, (uint64_t) file_status.st_size, consume, user);
+            if (result <= 0){
+                return result;
+            }
+        }
+    }
+    return sha_io_read_pipelined(fd, consume, user);
+}
+
+// "-" reads stdin
+int sha_io_read_path (const char *path, sha_io_consumer consume, void *user){
+    int fd, result;
+
+    if (strcmp(path, "-") == 0){
+        return sha_io_read_fd(STDIN_FILENO, consume, user);
+    }
+    if ((fd = open(path, O_RDONLY)) < 0){
+        return -1;
+    }
+    result = sha_io_read_fd(fd, consume, user);
+    close(fd);
+    return result;
+}
+
+// maps a whole regular file for random access (tree mode), an empty file gives data = NULL and size = 0
+int sha_io_map_path (const char *path, const uint8_t **data, uint64_t *size){
+    int fd;
+    struct stat file_status;
+    void *mapping;
+
+    *data = NULL;
+    *size = 0;
+    if ((fd = open(path, O_RDONLY)) < 0){
+        return -1;
+    }
+    if (fstat(fd, &file_status) != 0 || !S_ISREG(file_status.st_mode) ||
+        (uint64_t) file_status.st_size > (uint64_t) SIZE_MAX){
+        close(fd);
+        return -1;
+    }
+    if (file_status.st_size > 0){
+        mapping = mmap(NULL, (size_t) file_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED){
+            close(fd);
+            return -1;
+        }
+        *data = (const uint8_t *) mapping;
+        *size = (uint64_t) file_status.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+void sha_io_unmap (const uint8_t *data, uint64_t size){
+    if (data != NULL){
+        munmap((void *) data, (size_t) size);
+    }
+}
+
+// writes all of data to fd, retrying short writes
+static int sha_io_write_all (int fd, const uint8_t *data, uint64_t size){
+    while (size > 0){
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR){
+            continue;
+        }
+        if (written <= 0){
+            return -1;
+        }
+        data += written;
+        size -= (uint64_t) written;
+    }
+    return 0;
+}
+
+// reads exactly size bytes, they are known to be waiting in the pipe already
+static int sha_io_read_exact (int fd, uint8_t *data, uint64_t size){
+    while (size > 0){
+        ssize_t bytes_read = read(fd, data, size);
+        if (bytes_read < 0 && errno == EINTR){
+            continue;
+        }
+        if (bytes_read <= 0){
+            return -1;
+        }
+        data += bytes_read;
+        size -= (uint64_t) bytes_read;
+    }
+    return 0;
+}
+
+// feeds everything in_fd holds to consume and copies it unchanged to out_fd. when both are pipes, tee() duplicates
+// the pipe pages into out_fd inside the kernel and the bytes are only read once, for hashing; otherwise every piece
+// is read into one buffer and written back out from it, which copies it through user space twice. the pipes
+// belong to the processes on either side too, so their size is left alone. returns 0 when all of in_fd was copied,
+// and -1 on a read or write error or when consume returned non-zero.
+int sha_io_tee_fd (int in_fd, int out_fd, sha_io_consumer consume, void *user){
+    uint8_t *buffer;
+    int use_tee = 1, result = 0;
+
+    // page aligned, so reads fill whole pages and the kernel can copy them page by page
+    if (posix_memalign((void **) &buffer, (size_t) sysconf(_SC_PAGESIZE), SHA_IO_BUFFER_SIZE) != 0){
+        return -1;
+    }
+
+    for (;;){
+        ssize_t size = -1;
+
+#ifdef SPLICE_F_NONBLOCK
+        if (use_tee){
+            size = tee(in_fd, out_fd, SHA_IO_BUFFER_SIZE, 0);
+            if (size < 0 && errno == EINTR){
+                continue;
+            }
+            if (size < 0 && errno == EINVAL){
+                // one of them is not a pipe
+                use_tee = 0;
+            } else if (size < 0 || (size > 0 && sha_io_read_exact(in_fd, buffer, (uint64_t) size) != 0)){
+                result = -1;
+                break;
+            }
+        }
+#else
+        use_tee = 0;
+#endif
+        if (!use_tee){
+            size = read(in_fd, buffer, SHA_IO_BUFFER_SIZE);
+            if (size < 0 && errno == EINTR){
+                continue;
+            }
+            if (size < 0 || (size > 0 && sha_io_write_all(out_fd, buffer, (uint64_t) size) != 0)){
+                result = -1;
+                break;
+            }
+        }
+        if (size == 0){
+            break;
+        }
+        if (consume(user, buffer, (uint64_t) size) != 0){
+            result = -1;
+            break;
+        }
+    }
+    free(buffer);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef SHA_IO_H
+#define SHA_IO_H
+#include <stdint.h>
+
+// receives the input piece by piece, in order; a non-zero return stops the read
+typedef int (*sha_io_consumer) (void *user, const uint8_t *data, uint64_t size);
+
+// regular files are mapped this many bytes at a time, pipes are read through two buffers of SHA_IO_BUFFER_SIZE
+#define SHA_IO_MAP_WINDOW (1ULL << 30)
+#define SHA_IO_BUFFER_SIZE (1 << 20)
+
+#include "sha_io.c"
+
+int sha_io_read_fd (int fd, sha_io_consumer consume, void *user);
+
+int sha_io_read_path (const char *path, sha_io_consumer consume, void *user);
+
+int sha_io_tee_fd (int in_fd, int out_fd, sha_io_consumer consume, void *user);
+
+int sha_io_map_path (const char *path, const uint8_t **data, uint64_t *size);
+
+void sha_io_unmap (const uint8_t *data, uint64_t size);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,597 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "sha_selftest.h"
+#include "hmac.h"
+#include "pbkdf2.h"
+#include "cdc.h"
+#include "sha_tree.h"
+
+// FIPS 180-4 example messages, each one is hashed `repeat` times back to back
+typedef struct sha_test_vector {
+    const char *message;
+    uint32_t repeat;
+    const char *sha256_hex;
+    const char *sha512_hex;
+} sha_test_vector;
+
+static const sha_test_vector SHA_TEST_VECTORS[] = {
+    {"", 1,
+     "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+     "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e"},
+    {"abc", 1,
+     "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+     "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+     "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+     NULL},
+    {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+     NULL,
+     "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909"},
+    {"a", 1000000,
+     "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+     "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973ebde0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b"},
+};
+
+#define SHA_TEST_VECTOR_COUNT (sizeof(SHA_TEST_VECTORS) / sizeof(SHA_TEST_VECTORS[0]))
+
+// RFC 4231 test cases 1 to 7, key and data are each a string repeated `repeat` times. case 5 only checks the
+// first 128 bits, so the expected values are compared for their own length.
+typedef struct hmac_test_vector {
+    const char *key;
+    uint32_t key_repeat;
+    const char *data;
+    uint32_t data_repeat;
+    const char *sha256_hex;
+    const char *sha512_hex;
+} hmac_test_vector;
+
+static const hmac_test_vector HMAC_TEST_VECTORS[] = {
+    {"\x0b", 20, "Hi There", 1,
+     "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+     "87aa7cdea5ef619d4ff0b4241a1d6cb02379f4e2ce4ec2787ad0b30545e17cdedaa833b7d6b8a702038b274eaea3f4e4be9d914eeb61f1702e696c203a126854"},
+    {"Jefe", 1, "what do ya want for nothing?", 1,
+     "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+     "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea2505549758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737"},
+    {"\xaa", 20, "\xdd", 50,
+     "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe",
+     "fa73b0089d56a284efb0f0756c890be9b1b5dbdd8ee81a3655f83e33b2279d39bf3e848279a722c806b485a47e67c807b946a337bee8942674278859e13292fb"},
+    {"\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19", 1, "\xcd", 50,
+     "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b",
+     "b0ba465637458c6990e5a8c5f61d4af7e576d97ff94b872de76f8050361ee3dba91ca5c11aa25eb4d679275cc5788063a5f19741120c4f2de2adebeb10a298dd"},
+    {"\x0c", 20, "Test With Truncation", 1,
+     "a3b6167473100ee06e0c796c2955552b",
+     "415fad6271580a531d4179bc891d87a6"},
+    {"\xaa", 131, "Test Using Larger Than Block-Size Key - Hash Key First", 1,
+     "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+     "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f3526b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598"},
+    {"\xaa", 131, "This is a test using a larger than block-size key and a larger than block-size data. The key needs to be "
+     "hashed before being used by the HMAC algorithm.", 1,
+     "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2",
+     "e37b6a775dc87dbaa4dfa9f96e5e3ffddebd71f8867289865df5a32d20cdc944b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58"},
+};
+
+#define HMAC_TEST_VECTOR_COUNT (sizeof(HMAC_TEST_VECTORS) / sizeof(HMAC_TEST_VECTORS[0]))
+
+// PBKDF2-HMAC-SHA256 values from RFC 7914 section 11 and the commonly published 4096 iteration cases; the sha512
+// values for the same inputs are from an independent implementation. the 40 and 64 byte outputs span two blocks.
+typedef struct pbkdf2_test_vector {
+    const char *password;
+    const char *salt;
+    uint32_t iterations;
+    const char *sha256_hex;
+    const char *sha512_hex;
+} pbkdf2_test_vector;
+
+static const pbkdf2_test_vector PBKDF2_TEST_VECTORS[] = {
+    {"passwd", "salt", 1,
+     "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783",
+     "c74319d99499fc3e9013acff597c23c5baf0a0bec5634c46b8352b793e324723d55caa76b2b25c43402dcfdc06cdcf66f95b7d0429420b39520006749c51a04e"},
+    {"password", "salt", 4096,
+     "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a",
+     "d197b1b33db0143e018b12f3d1d1479e6cdebdcc97c5c0f87f6902e072f457b5"},
+    {"passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096,
+     "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e9",
+     "8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868c005174dc4ee71115b59f9e60cd953"},
+};
+
+#define PBKDF2_TEST_VECTOR_COUNT (sizeof(PBKDF2_TEST_VECTORS) / sizeof(PBKDF2_TEST_VECTORS[0]))
+
+static int sha_digest_matches (const uint8_t *digest, uint32_t digest_size, const char *expected_hex){
+    char hex[129];
+
+    for (uint32_t i = 0; i < digest_size; i++){
+        sprintf(hex + 2 * i, "%02x", digest[i]);
+    }
+    return strcmp(hex, expected_hex) == 0;
+}
+
+static int sha256_self_test_kernel (FILE *log){
+    int failures = 0;
+    uint8_t digest[32];
+    sha256_ctx ctx;
+
+    for (uint32_t i = 0; i < SHA_TEST_VECTOR_COUNT; i++){
+        const sha_test_vector *vector = &SHA_TEST_VECTORS[i];
+        if (vector->sha256_hex == NULL){
+            continue;
+        }
+        sha256_init(&ctx);
+        for (uint32_t j = 0; j < vector->repeat; j++){
+            sha256_update(&ctx, (const uint8_t *) vector->message, strlen(vector->message));
+        }
+        sha256_final(&ctx, digest);
+        if (!sha_digest_matches(digest, 32, vector->sha256_hex)){
+            fprintf(log, "sha256/%s: vector %u FAILED\n", sha256_kernel_name(sha256_get_kernel()), i);
+            failures++;
+        }
+    }
+    // the one-block path against the streaming api, up to the first length that needs two blocks
+    for (uint32_t len = 0; len <= SHA256_ONE_BLOCK_MAX + 1; len++){
+        uint8_t message[SHA256_ONE_BLOCK_MAX + 1], one_block[32];
+        for (uint32_t i = 0; i < len; i++){
+            message[i] = (uint8_t) (i * 13 + len);
+        }
+        sha256_init(&ctx);
+        sha256_update(&ctx, message, len);
+        sha256_final(&ctx, digest);
+        sha256_digest(message, len, one_block);
+        if (memcmp(digest, one_block, 32) != 0){
+            fprintf(log, "sha256/%s: one-block length %u FAILED\n", sha256_kernel_name(sha256_get_kernel()), len);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+static int sha512_self_test_kernel (FILE *log){
+    int failures = 0;
+    uint8_t digest[64];
+    sha512_ctx ctx;
+
+    for (uint32_t i = 0; i < SHA_TEST_VECTOR_COUNT; i++){
+        const sha_test_vector *vector = &SHA_TEST_VECTORS[i];
+        if (vector->sha512_hex == NULL){
+            continue;
+        }
+        sha512_init(&ctx);
+        for (uint32_t j = 0; j < vector->repeat; j++){
+            sha512_update(&ctx, (const uint8_t *) vector->message, strlen(vector->message));
+        }
+        sha512_final(&ctx, digest);
+        if (!sha_digest_matches(digest, 64, vector->sha512_hex)){
+            fprintf(log, "sha512/%s: vector %u FAILED\n", sha512_kernel_name(sha512_get_kernel()), i);
+            failures++;
+        }
+    }
+    // the one-block path against the streaming api, up to the first length that needs two blocks
+    for (uint32_t len = 0; len <= SHA512_ONE_BLOCK_MAX + 1; len++){
+        uint8_t message[SHA512_ONE_BLOCK_MAX + 1], one_block[64];
+        for (uint32_t i = 0; i < len; i++){
+            message[i] = (uint8_t) (i * 13 + len);
+        }
+        sha512_init(&ctx);
+        sha512_update(&ctx, message, len);
+        sha512_final(&ctx, digest);
+        sha512_digest(message, len, one_block);
+        if (memcmp(digest, one_block, 64) != 0){
+            fprintf(log, "sha512/%s: one-block length %u FAILED\n", sha512_kernel_name(sha512_get_kernel()), len);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// writes a string repeated `repeat` times into buffer, returns the length
+static uint32_t sha_test_expand (uint8_t *buffer, const char *text, uint32_t repeat){
+    uint32_t len = (uint32_t) strlen(text);
+
+    for (uint32_t i = 0; i < repeat; i++){
+        memcpy(buffer + i * len, text, len);
+    }
+    return len * repeat;
+}
+
+// splits a vector at every offset: the prefix context is exported, imported and cloned, and both copies must
+// still finish with the known digest
+static int sha_midstate_self_test (FILE *log){
+    const sha_test_vector *vector256 = &SHA_TEST_VECTORS[2], *vector512 = &SHA_TEST_VECTORS[3];
+    uint8_t state[SHA512_STATE_SIZE], digest[64], clone_digest[64];
+    sha256_ctx ctx256, copy256;
+    sha512_ctx ctx512, copy512;
+    int failures = 0;
+
+    for (uint32_t split = 0; split <= strlen(vector256->message); split++){
+        const uint8_t *message = (const uint8_t *) vector256->message;
+        sha256_init(&ctx256);
+        sha256_update(&ctx256, message, split);
+        sha256_export(&ctx256, state);
+        if (sha256_import(&ctx256, state) != 0){
+            failures++;
+            continue;
+        }
+        sha256_clone(&copy256, &ctx256);
+        sha256_update(&ctx256, message + split, strlen(vector256->message) - split);
+        sha256_update(&copy256, message + split, strlen(vector256->message) - split);
+        sha256_final(&ctx256, digest);
+        sha256_final(&copy256, clone_digest);
+        if (!sha_digest_matches(digest, 32, vector256->sha256_hex) || memcmp(digest, clone_digest, 32) != 0){
+            fprintf(log, "sha256 midstate: split at %u FAILED\n", split);
+            failures++;
+        }
+    }
+    for (uint32_t split = 0; split <= strlen(vector512->message); split++){
+        const uint8_t *message = (const uint8_t *) vector512->message;
+        sha512_init(&ctx512);
+        sha512_update(&ctx512, message, split);
+        sha512_export(&ctx512, state);
+        if (sha512_import(&ctx512, state) != 0){
+            failures++;
+            continue;
+        }
+        sha512_clone(&copy512, &ctx512);
+        sha512_update(&ctx512, message + split, strlen(vector512->message) - split);
+        sha512_update(&copy512, message + split, strlen(vector512->message) - split);
+        sha512_final(&ctx512, digest);
+        sha512_final(&copy512, clone_digest);
+        if (!sha_digest_matches(digest, 64, vector512->sha512_hex) || memcmp(digest, clone_digest, 64) != 0){
+            fprintf(log, "sha512 midstate: split at %u FAILED\n", split);
+            failures++;
+        }
+    }
+
+    // a sha512 state is not a sha256 state
+    if (sha256_import(&ctx256, state) == 0){
+        fprintf(log, "sha256 midstate: foreign state accepted FAILED\n");
+        failures++;
+    }
+    return failures;
+}
+
+// the vectors through the streaming api and, one message per call, through the batch api
+static int hmac_self_test_vectors (FILE *log){
+    uint8_t key[256], data[256], mac[64], batch256[1][32], batch512[1][64];
+    const uint8_t *msgs[1] = {data};
+    size_t lens[1];
+    hmac_sha256_key key256;
+    hmac_sha512_key key512;
+    int failures = 0;
+
+    for (uint32_t i = 0; i < HMAC_TEST_VECTOR_COUNT; i++){
+        const hmac_test_vector *vector = &HMAC_TEST_VECTORS[i];
+        uint32_t key_size = sha_test_expand(key, vector->key, vector->key_repeat);
+        uint32_t data_size = sha_test_expand(data, vector->data, vector->data_repeat);
+        uint32_t size256 = (uint32_t) strlen(vector->sha256_hex) / 2;
+        uint32_t size512 = (uint32_t) strlen(vector->sha512_hex) / 2;
+
+        lens[0] = data_size;
+        hmac_sha256_set_key(&key256, key, key_size);
+        hmac_sha256(&key256, data, data_size, mac);
+        hmac_sha256_batch(&key256, msgs, lens, 1, batch256);
+        if (!sha_digest_matches(mac, size256, vector->sha256_hex) || !sha_digest_matches(batch256[0], size256, vector->sha256_hex)){
+            fprintf(log, "hmac_sha256: rfc 4231 case %u FAILED\n", i + 1);
+            failures++;
+        }
+        hmac_sha512_set_key(&key512, key, key_size);
+        hmac_sha512(&key512, data, data_size, mac);
+        hmac_sha512_batch(&key512, msgs, lens, 1, batch512);
+        if (!sha_digest_matches(mac, size512, vector->sha512_hex) || !sha_digest_matches(batch512[0], size512, vector->sha512_hex)){
+            fprintf(log, "hmac_sha512: rfc 4231 case %u FAILED\n", i + 1);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// the vectors through the single and the batch api; the batch calls carry one password, so the lanes are filled
+// by its output blocks
+static int pbkdf2_self_test_vectors (FILE *log){
+    uint8_t key[64], batch_key[64];
+    uint8_t *out[1] = {batch_key};
+    int failures = 0;
+
+    for (uint32_t i = 0; i < PBKDF2_TEST_VECTOR_COUNT; i++){
+        const pbkdf2_test_vector *vector = &PBKDF2_TEST_VECTORS[i];
+        const uint8_t *password = (const uint8_t *) vector->password, *salt = (const uint8_t *) vector->salt;
+        size_t password_len = strlen(vector->password), salt_len = strlen(vector->salt);
+        size_t size = strlen(vector->sha256_hex) / 2;
+
+        pbkdf2_sha256(password, password_len, salt, salt_len, vector->iterations, key, size);
+        pbkdf2_sha256_batch(&password, &password_len, &salt, &salt_len, 1, vector->iterations, out, size);
+        if (!sha_digest_matches(key, (uint32_t) size, vector->sha256_hex) || memcmp(key, batch_key, size) != 0){
+            fprintf(log, "pbkdf2_sha256/%s: vector %u FAILED\n", sha_batch_kernel_name(sha256_batch_get_kernel()), i);
+            failures++;
+        }
+        pbkdf2_sha512(password, password_len, salt, salt_len, vector->iterations, key, size);
+        pbkdf2_sha512_batch(&password, &password_len, &salt, &salt_len, 1, vector->iterations, out, size);
+        if (!sha_digest_matches(key, (uint32_t) size, vector->sha512_hex) || memcmp(key, batch_key, size) != 0){
+            fprintf(log, "pbkdf2_sha512/%s: vector %u FAILED\n", sha_batch_kernel_name(sha512_batch_get_kernel()), i);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// passwords and salts of different lengths in one batch, with an output of two blocks, against the single api
+#define PBKDF2_BATCH_TEST_PASSWORDS 37
+
+static int pbkdf2_self_test_batch (FILE *log){
+    static uint8_t text[256], batch256[PBKDF2_BATCH_TEST_PASSWORDS][40], batch512[PBKDF2_BATCH_TEST_PASSWORDS][80];
+    const uint8_t *passwords[PBKDF2_BATCH_TEST_PASSWORDS], *salts[PBKDF2_BATCH_TEST_PASSWORDS];
+    size_t password_lens[PBKDF2_BATCH_TEST_PASSWORDS], salt_lens[PBKDF2_BATCH_TEST_PASSWORDS];
+    uint8_t *out256[PBKDF2_BATCH_TEST_PASSWORDS], *out512[PBKDF2_BATCH_TEST_PASSWORDS];
+    uint8_t key[80];
+    int failures = 0;
+
+    for (uint32_t i = 0; i < sizeof(text); i++){
+        text[i] = (uint8_t) (i * 11 + 5);
+    }
+    for (uint32_t i = 0; i < PBKDF2_BATCH_TEST_PASSWORDS; i++){
+        passwords[i] = text + i;
+        password_lens[i] = (i * 7) % 150;
+        salts[i] = text + 2 * i;
+        salt_lens[i] = (i * 5) % 140;
+        out256[i] = batch256[i];
+        out512[i] = batch512[i];
+    }
+    pbkdf2_sha256_batch(passwords, password_lens, salts, salt_lens, PBKDF2_BATCH_TEST_PASSWORDS, 3, out256, 40);
+    pbkdf2_sha512_batch(passwords, password_lens, salts, salt_lens, PBKDF2_BATCH_TEST_PASSWORDS, 3, out512, 80);
+
+    for (uint32_t i = 0; i < PBKDF2_BATCH_TEST_PASSWORDS; i++){
+        pbkdf2_sha256(passwords[i], password_lens[i], salts[i], salt_lens[i], 3, key, 40);
+        if (memcmp(key, batch256[i], 40) != 0){
+            fprintf(log, "pbkdf2_sha256_batch/%s: password %u FAILED\n", sha_batch_kernel_name(sha256_batch_get_kernel()), i);
+            failures++;
+        }
+        pbkdf2_sha512(passwords[i], password_lens[i], salts[i], salt_lens[i], 3, key, 80);
+        if (memcmp(key, batch512[i], 80) != 0){
+            fprintf(log, "pbkdf2_sha512_batch/%s: password %u FAILED\n", sha_batch_kernel_name(sha512_batch_get_kernel()), i);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// the batch kernels must agree with the streaming api on every length around the block and padding boundaries,
+// with all lengths mixed in one batch so lanes finish at different times
+#define SHA_BATCH_TEST_MESSAGES 300
+
+static int sha_batch_self_test_kernel (FILE *log){
+    static uint8_t data[SHA_BATCH_TEST_MESSAGES];
+    static uint8_t batch256[SHA_BATCH_TEST_MESSAGES][32], batch512[SHA_BATCH_TEST_MESSAGES][64];
+    const uint8_t *msgs[SHA_BATCH_TEST_MESSAGES];
+    size_t lens[SHA_BATCH_TEST_MESSAGES];
+    uint8_t digest[64];
+    sha256_ctx ctx256;
+    sha512_ctx ctx512;
+    hmac_sha256_key key256;
+    hmac_sha512_key key512;
+    int failures = 0;
+
+    for (uint32_t i = 0; i < SHA_BATCH_TEST_MESSAGES; i++){
+        data[i] = (uint8_t) (i * 7 + 3);
+        msgs[i] = data;
+        lens[i] = (i * 37) % SHA_BATCH_TEST_MESSAGES;
+    }
+    sha256_batch(msgs, lens, SHA_BATCH_TEST_MESSAGES, batch256);
+    sha512_batch(msgs, lens, SHA_BATCH_TEST_MESSAGES, batch512);
+
+    for (uint32_t i = 0; i < SHA_BATCH_TEST_MESSAGES; i++){
+        sha256_init(&ctx256);
+        sha256_update(&ctx256, msgs[i], lens[i]);
+        sha256_final(&ctx256, digest);
+        if (memcmp(digest, batch256[i], 32) != 0){
+            fprintf(log, "sha256_batch/%s: length %zu FAILED\n", sha_batch_kernel_name(sha256_batch_get_kernel()), lens[i]);
+            failures++;
+        }
+        sha512_init(&ctx512);
+        sha512_update(&ctx512, msgs[i], lens[i]);
+        sha512_final(&ctx512, digest);
+        if (memcmp(digest, batch512[i], 64) != 0){
+            fprintf(log, "sha512_batch/%s: length %zu FAILED\n", sha_batch_kernel_name(sha512_batch_get_kernel()), lens[i]);
+            failures++;
+        }
+    }
+
+    // hmac runs the lanes from the keyed midstates instead of the initial hash values
+    hmac_sha256_set_key(&key256, data, 40);
+    hmac_sha512_set_key(&key512, data, 40);
+    hmac_sha256_batch(&key256, msgs, lens, SHA_BATCH_TEST_MESSAGES, batch256);
+    hmac_sha512_batch(&key512, msgs, lens, SHA_BATCH_TEST_MESSAGES, batch512);
+
+    for (uint32_t i = 0; i < SHA_BATCH_TEST_MESSAGES; i++){
+        hmac_sha256(&key256, msgs[i], lens[i], digest);
+        if (memcmp(digest, batch256[i], 32) != 0){
+            fprintf(log, "hmac_sha256_batch/%s: length %zu FAILED\n", sha_batch_kernel_name(sha256_batch_get_kernel()), lens[i]);
+            failures++;
+        }
+        hmac_sha512(&key512, msgs[i], lens[i], digest);
+        if (memcmp(digest, batch512[i], 64) != 0){
+            fprintf(log, "hmac_sha512_batch/%s: length %zu FAILED\n", sha_batch_kernel_name(sha512_batch_get_kernel()), lens[i]);
+            failures++;
+        }
+    }
+
+    return failures + hmac_self_test_vectors(log) + pbkdf2_self_test_vectors(log) + pbkdf2_self_test_batch(log);
+}
+
+// the chunker must find the same cut points however the input is split into updates, and each chunk digest must
+// be the sha256 of exactly its bytes. the pooled run collects all pieces before one flush, so its chunks are
+// hashed in several groups on the pool
+#define CDC_TEST_SIZE (200 << 10)
+#define CDC_TEST_MAX_CHUNKS 1024
+
+typedef struct cdc_test_records {
+    cdc_record records[CDC_TEST_MAX_CHUNKS];
+    size_t count;
+} cdc_test_records;
+
+static int cdc_test_collect (void *user, const cdc_record *record){
+    cdc_test_records *collected = (cdc_test_records *) user;
+
+    if (collected->count == CDC_TEST_MAX_CHUNKS){
+        return -1;
+    }
+    collected->records[collected->count++] = *record;
+    return 0;
+}
+
+static int cdc_self_test (FILE *log){
+    static uint8_t data[CDC_TEST_SIZE];
+    static cdc_test_records whole, pieces, pooled;
+    const cdc_params params = {256, 1024, 4096};
+    uint64_t state = 1, offset = 0;
+    uint8_t digest[32];
+    cdc_chunker chunker;
+    thread_pool *pool;
+    int failures = 0;
+
+    for (uint32_t i = 0; i < CDC_TEST_SIZE; i++){
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = (uint8_t) (state >> 56);
+    }
+    whole.count = 0;
+    pieces.count = 0;
+    pooled.count = 0;
+    cdc_init(&chunker, &params, NULL, cdc_test_collect, &whole);
+    cdc_update(&chunker, data, CDC_TEST_SIZE);
+    cdc_final(&chunker);
+    cdc_free(&chunker);
+
+    cdc_init(&chunker, &params, NULL, cdc_test_collect, &pieces);
+    for (uint64_t piece = 1; offset < CDC_TEST_SIZE; piece = piece * 3 + 1){
+        uint64_t size = (piece % 5000 < CDC_TEST_SIZE - offset) ? piece % 5000 : CDC_TEST_SIZE - offset;
+        cdc_update(&chunker, data + offset, size);
+        offset += size;
+    }
+    cdc_final(&chunker);
+    cdc_free(&chunker);
+
+    if ((pool = thread_pool_create(2)) == NULL){
+        fprintf(log, "cdc: could not start the pool FAILED\n");
+        return failures + 1;
+    }
+    cdc_init(&chunker, &params, pool, cdc_test_collect, &pooled);
+    for (offset = 0; offset < CDC_TEST_SIZE; offset += 3000){
+        cdc_collect(&chunker, data + offset, (CDC_TEST_SIZE - offset < 3000) ? CDC_TEST_SIZE - offset : 3000);
+    }
+    cdc_final(&chunker);
+    cdc_free(&chunker);
+    thread_pool_destroy(pool);
+
+    if (whole.count != pieces.count || memcmp(whole.records, pieces.records, whole.count * sizeof(cdc_record)) != 0){
+        fprintf(log, "cdc: chunks depend on the update sizes FAILED\n");
+        failures++;
+    }
+    if (whole.count <= CDC_HASH_GROUP || whole.count != pooled.count ||
+        memcmp(whole.records, pooled.records, whole.count * sizeof(cdc_record)) != 0){
+        fprintf(log, "cdc: pooled chunks FAILED\n");
+        failures++;
+    }
+    offset = 0;
+    for (size_t i = 0; i < whole.count; i++){
+        const cdc_record *record = &whole.records[i];
+        sha256_digest(data + record->offset, record->length, digest);
+        if (record->offset != offset || record->length > params.max_size || memcmp(digest, record->digest, 32) != 0){
+            fprintf(log, "cdc: chunk %zu FAILED\n", i);
+            failures++;
+        }
+        offset += record->length;
+    }
+    if (offset != CDC_TEST_SIZE){
+        fprintf(log, "cdc: chunks cover %llu of %u bytes FAILED\n", (unsigned long long) offset, CDC_TEST_SIZE);
+        failures++;
+    }
+    return failures;
+}
+
+// six chunks with a short last one, so every level has an unpaired node at some point. the roots were computed
+// independently from the layout in sha_tree.h, and must come out the same for any thread count
+#define SHA_TREE_TEST_SIZE 5220
+#define SHA_TREE_TEST_CHUNK 1024
+
+static const char *SHA256_TREE_TEST_ROOT = "c25b7dc1dc91517b2dbe17fc29a3e997c3ebd6eb766c785f1d3500f3559f23be";
+static const char *SHA512_TREE_TEST_ROOT = "c5ef521e8d028b685b112e1b407c5c29f38542d06595dcd8c30867960d5eafbd"
+                                           "8e3adbe03cd608035ec9d44d703cb7c3982bae1259cd026d5f043c86920834d0";
+
+static int sha_tree_self_test (FILE *log){
+    static uint8_t data[SHA_TREE_TEST_SIZE];
+    const uint32_t thread_counts[4] = {1, 2, 7, thread_pool_default_threads()};
+    uint8_t digest[64];
+    int failures = 0;
+
+    for (uint32_t i = 0; i < SHA_TREE_TEST_SIZE; i++){
+        data[i] = (uint8_t) (i * 131 + (i >> 8));
+    }
+    for (uint32_t i = 0; i < 4; i++){
+        if (sha256_tree(data, SHA_TREE_TEST_SIZE, SHA_TREE_TEST_CHUNK, thread_counts[i], digest) != 0 ||
+            !sha_digest_matches(digest, 32, SHA256_TREE_TEST_ROOT)){
+            fprintf(log, "tree: sha256 with %u threads FAILED\n", thread_counts[i]);
+            failures++;
+        }
+        if (sha512_tree(data, SHA_TREE_TEST_SIZE, SHA_TREE_TEST_CHUNK, thread_counts[i], digest) != 0 ||
+            !sha_digest_matches(digest, 64, SHA512_TREE_TEST_ROOT)){
+            fprintf(log, "tree: sha512 with %u threads FAILED\n", thread_counts[i]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// runs the test vectors through every compression kernel this cpu supports, returns the number of failures
+int sha_self_test (FILE *log){
+    int failures = 0, kernel_failures;
+    enum sha256_kernel sha256_saved = sha256_get_kernel();
+    enum sha512_kernel sha512_saved = sha512_get_kernel();
+
+    for (uint32_t kernel = SHA256_KERNEL_AUTO + 1; kernel < SHA256_KERNEL_COUNT; kernel++){
+        if (sha256_set_kernel(kernel) != 0){
+            fprintf(log, "sha256/%s: not supported, skipped\n", sha256_kernel_name(kernel));
+            continue;
+        }
+        kernel_failures = sha256_self_test_kernel(log);
+        fprintf(log, "sha256/%s: %s\n", sha256_kernel_name(kernel), kernel_failures ? "FAILED" : "ok");
+        failures += kernel_failures;
+    }
+    sha256_set_kernel(sha256_saved);
+
+    for (uint32_t kernel = SHA512_KERNEL_AUTO + 1; kernel < SHA512_KERNEL_COUNT; kernel++){
+        if (sha512_set_kernel(kernel) != 0){
+            fprintf(log, "sha512/%s: not supported, skipped\n", sha512_kernel_name(kernel));
+            continue;
+        }
+        kernel_failures = sha512_self_test_kernel(log);
+        fprintf(log, "sha512/%s: %s\n", sha512_kernel_name(kernel), kernel_failures ? "FAILED" : "ok");
+        failures += kernel_failures;
+    }
+    sha512_set_kernel(sha512_saved);
+
+    kernel_failures = sha_midstate_self_test(log);
+    fprintf(log, "midstate: %s\n", kernel_failures ? "FAILED" : "ok");
+    failures += kernel_failures;
+
+    kernel_failures = hmac_self_test_vectors(log);
+    fprintf(log, "hmac: %s\n", kernel_failures ? "FAILED" : "ok");
+    failures += kernel_failures;
+
+    kernel_failures = sha_tree_self_test(log);
+    fprintf(log, "tree: %s\n", kernel_failures ? "FAILED" : "ok");
+    failures += kernel_failures;
+
+    kernel_failures = cdc_self_test(log);
+    fprintf(log, "cdc: %s\n", kernel_failures ? "FAILED" : "ok");
+    failures += kernel_failures;
+
+    for (uint32_t kernel = SHA_BATCH_KERNEL_AUTO + 1; kernel < SHA_BATCH_KERNEL_COUNT; kernel++){
+        if (sha_batch_set_kernel(kernel) != 0){
+            fprintf(log, "batch/%s: not supported, skipped\n", sha_batch_kernel_name(kernel));
+            continue;
+        }
+        kernel_failures = sha_batch_self_test_kernel(log);
+        fprintf(log, "batch/%s: %s\n", sha_batch_kernel_name(kernel), kernel_failures ? "FAILED" : "ok");
+        failures += kernel_failures;
+    }
+    sha_batch_set_kernel(SHA_BATCH_KERNEL_AUTO);
+
+    return failures;
+}
\ No newline at end of file
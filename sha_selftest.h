@@ -0,0 +1,15 @@
+#ifndef SHA_SELFTEST_H
+#define SHA_SELFTEST_H
+#include <stdio.h>
+#include "sha256.h"
+#include "sha512.h"
+#include "sha_batch.h"
+#include "hmac.h"
+#include "pbkdf2.h"
+#include "cdc.h"
+#include "sha_tree.h"
+#include "sha_selftest.c"
+
+int sha_self_test (FILE *log);
+
+#endif
\ No newline at end of file
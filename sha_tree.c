@@ -0,0 +1,118 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sha_tree.h"
+#include "sha256.h"
+#include "sha512.h"
+#include "thread_pool.h"
+
+#define SHA_TREE_LEAF 0x00
+#define SHA_TREE_PARENT 0x01
+
+typedef struct sha_tree_job {
+    const uint8_t *data;
+    uint64_t data_size_bytes;
+    uint32_t digest_size;
+    uint8_t *node;
+} sha_tree_job;
+
+// H(prefix || first || second) with the hash picked by digest size
+static void sha_tree_node_hash (uint32_t digest_size, uint8_t prefix, const uint8_t *first, uint64_t first_size,
+                                const uint8_t *second, uint64_t second_size, uint8_t *node){
+    if (digest_size == 32){
+        sha256_ctx ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, &prefix, 1);
+        sha256_update(&ctx, first, first_size);
+        sha256_update(&ctx, second, second_size);
+        sha256_final(&ctx, node);
+    } else {
+        sha512_ctx ctx;
+        sha512_init(&ctx);
+        sha512_update(&ctx, &prefix, 1);
+        sha512_update(&ctx, first, first_size);
+        sha512_update(&ctx, second, second_size);
+        sha512_final(&ctx, node);
+    }
+}
+
+static void sha_tree_leaf_job (void *arg){
+    sha_tree_job *job = (sha_tree_job *) arg;
+    sha_tree_node_hash(job->digest_size, SHA_TREE_LEAF, job->data, job->data_size_bytes, NULL, 0, job->node);
+}
+
+static int sha_tree_hash (uint32_t digest_size, const uint8_t *data, uint64_t data_size_bytes, uint64_t chunk_size,
+                          uint32_t num_threads, uint8_t *digest){
+    uint64_t num_of_chunks, num_of_nodes;
+    uint8_t *nodes;
+    sha_tree_job *jobs;
+    thread_pool *pool = NULL;
+
+    if (chunk_size == 0){
+        return -1;
+    }
+    num_of_chunks = data_size_bytes / chunk_size + (data_size_bytes % chunk_size != 0);
+    if (num_of_chunks == 0){
+        num_of_chunks = 1;
+    }
+    nodes = (uint8_t *) malloc(num_of_chunks * digest_size);
+    jobs = (sha_tree_job *) malloc(num_of_chunks * sizeof(sha_tree_job));
+    if (nodes == NULL || jobs == NULL){
+        free(nodes);
+        free(jobs);
+        return -1;
+    }
+
+    for (uint64_t i = 0; i < num_of_chunks; i++){
+        uint64_t offset = i * chunk_size;
+        jobs[i].data = data + offset;
+        jobs[i].data_size_bytes = (data_size_bytes - offset < chunk_size) ? data_size_bytes - offset : chunk_size;
+        jobs[i].digest_size = digest_size;
+        jobs[i].node = nodes + i * digest_size;
+    }
+
+    // the leaves are independent, so they go to the workers; without a pool they are hashed right here
+    if (num_threads != 1 && num_of_chunks > 1){
+        pool = thread_pool_create(num_threads);
+    }
+    if (pool != NULL){
+        for (uint64_t i = 0; i < num_of_chunks; i++){
+            thread_pool_submit(pool, sha_tree_leaf_job, &jobs[i]);
+        }
+        thread_pool_wait(pool);
+        thread_pool_destroy(pool);
+    } else {
+        for (uint64_t i = 0; i < num_of_chunks; i++){
+            sha_tree_leaf_job(&jobs[i]);
+        }
+    }
+
+    // the upper levels are only a few kilobytes of digests, they are combined in place on this thread
+    num_of_nodes = num_of_chunks;
+    while (num_of_nodes > 1){
+        uint64_t parents = 0;
+        for (uint64_t i = 0; i + 1 < num_of_nodes; i += 2, parents++){
+            sha_tree_node_hash(digest_size, SHA_TREE_PARENT, nodes + i * digest_size, digest_size,
+                               nodes + (i + 1) * digest_size, digest_size, nodes + parents * digest_size);
+        }
+        if (num_of_nodes % 2){
+            memmove(nodes + parents * digest_size, nodes + (num_of_nodes - 1) * digest_size, digest_size);
+            parents++;
+        }
+        num_of_nodes = parents;
+    }
+    memcpy(digest, nodes, digest_size);
+
+    free(nodes);
+    free(jobs);
+    return 0;
+}
+
+// both return 0 on success and -1 when chunk_size is 0 or memory runs out; num_threads 0 means one per core
+int sha256_tree(const uint8_t *data, uint64_t data_size_bytes, uint64_t chunk_size, uint32_t num_threads, uint8_t digest[32]){
+    return sha_tree_hash(32, data, data_size_bytes, chunk_size, num_threads, digest);
+}
+
+int sha512_tree(const uint8_t *data, uint64_t data_size_bytes, uint64_t chunk_size, uint32_t num_threads, uint8_t digest[64]){
+    return sha_tree_hash(64, data, data_size_bytes, chunk_size, num_threads, digest);
+}
\ No newline at end of file
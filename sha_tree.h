@@ -0,0 +1,23 @@
+#ifndef SHA_TREE_H
+#define SHA_TREE_H
+#include <stdint.h>
+
+// Tree hash layout (the digest depends on the chunk size, never on the thread count):
+//
+//   the input is cut into chunks of chunk_size bytes, the last one may be shorter; an empty input is one empty chunk
+//   leaf   = H(0x00 || chunk)
+//   parent = H(0x01 || left || right)
+//   each level pairs up the nodes from left to right, an unpaired last node moves up to the next level unchanged
+//   the digest is the single node left at the top; a one chunk input therefore gives H(0x00 || data)
+//
+// H is sha256 or sha512 throughout.
+
+#define SHA_TREE_DEFAULT_CHUNK_SIZE (4ULL << 20)
+
+#include "sha_tree.c"
+
+int sha256_tree(const uint8_t *data, uint64_t data_size_bytes, uint64_t chunk_size, uint32_t num_threads, uint8_t digest[32]);
+
+int sha512_tree(const uint8_t *data, uint64_t data_size_bytes, uint64_t chunk_size, uint32_t num_threads, uint8_t digest[64]);
+
+#endif
\ No newline at end of file
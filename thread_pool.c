@@ -0,0 +1,230 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+typedef struct thread_pool_task {
+    thread_pool_fn fn;
+    void *arg;
+    struct thread_pool_task *newer;
+    struct thread_pool_task *older;
+} thread_pool_task;
+
+// every worker owns a deque: it pushes and pops its own work at the newest end, idle workers steal from the
+// oldest end of the others, so one worker stuck on a big task never strands the tasks queued behind it
+typedef struct thread_pool_deque {
+    pthread_mutex_t lock;
+    thread_pool_task *oldest;
+    thread_pool_task *newest;
+} thread_pool_deque;
+
+typedef struct thread_pool_worker {
+    thread_pool *pool;
+    uint32_t index;
+    thread_pool_deque deque;
+} thread_pool_worker;
+
+struct thread_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t task_ready;
+    pthread_cond_t all_done;
+    uint64_t queued;
+    uint64_t pending;
+    uint32_t next_deque;
+    int stopping;
+    uint32_t num_threads;
+    pthread_t *threads;
+    thread_pool_worker *workers;
+};
+
+// the worker running on this thread, tasks submitted from inside a task stay on the submitting worker's deque
+static __thread thread_pool_worker *thread_pool_current_worker = NULL;
+
+static void thread_pool_push (thread_pool_deque *deque, thread_pool_task *task){
+    pthread_mutex_lock(&deque->lock);
+    task->newer = NULL;
+    task->older = deque->newest;
+    if (deque->newest == NULL){
+        deque->oldest = task;
+    } else {
+        deque->newest->newer = task;
+    }
+    deque->newest = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static thread_pool_task *thread_pool_pop_newest (thread_pool_deque *deque){
+    thread_pool_task *task;
+
+    pthread_mutex_lock(&deque->lock);
+    task = deque->newest;
+    if (task != NULL){
+        deque->newest = task->older;
+        if (deque->newest == NULL){
+            deque->oldest = NULL;
+        } else {
+            deque->newest->newer = NULL;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+static thread_pool_task *thread_pool_steal_oldest (thread_pool_deque *deque){
+    thread_pool_task *task;
+
+    pthread_mutex_lock(&deque->lock);
+    task = deque->oldest;
+    if (task != NULL){
+        deque->oldest = task->newer;
+        if (deque->oldest == NULL){
+            deque->newest = NULL;
+        } else {
+            deque->oldest->older = NULL;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+static thread_pool_task *thread_pool_find_task (thread_pool_worker *worker){
+    thread_pool *pool = worker->pool;
+    thread_pool_task *task = thread_pool_pop_newest(&worker->deque);
+
+    for (uint32_t i = 1; task == NULL && i < pool->num_threads; i++){
+        task = thread_pool_steal_oldest(&pool->workers[(worker->index + i) % pool->num_threads].deque);
+    }
+    if (task != NULL){
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+static void *thread_pool_worker_main (void *arg){
+    thread_pool_worker *worker = (thread_pool_worker *) arg;
+    thread_pool *pool = worker->pool;
+    thread_pool_task *task;
+
+    thread_pool_current_worker = worker;
+    for (;;){
+        if ((task = thread_pool_find_task(worker)) != NULL){
+            task->fn(task->arg);
+            free(task);
+
+            pthread_mutex_lock(&pool->lock);
+            if (--pool->pending == 0){
+                pthread_cond_broadcast(&pool->all_done);
+            }
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        // nothing to run or steal: sleep until a submit bumps the queued count
+        pthread_mutex_lock(&pool->lock);
+        while (__atomic_load_n(&pool->queued, __ATOMIC_RELAXED) == 0 && !pool->stopping){
+            pthread_cond_wait(&pool->task_ready, &pool->lock);
+        }
+        if (__atomic_load_n(&pool->queued, __ATOMIC_RELAXED) == 0 && pool->stopping){
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+uint32_t thread_pool_default_threads (void){
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cores > 0) ? (uint32_t) cores : 1;
+}
+
+// finishes the queued tasks, then stops the workers
+void thread_pool_destroy (thread_pool *pool){
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->task_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint32_t i = 0; i < pool->num_threads; i++){
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (uint32_t i = 0; i < pool->num_threads; i++){
+        pthread_mutex_destroy(&pool->workers[i].deque.lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->task_ready);
+    pthread_cond_destroy(&pool->all_done);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+}
+
+thread_pool *thread_pool_create (uint32_t num_threads){
+    thread_pool *pool = (thread_pool *) calloc(1, sizeof(thread_pool));
+
+    if (pool == NULL){
+        return NULL;
+    }
+    if (num_threads == 0){
+        num_threads = thread_pool_default_threads();
+    }
+    pool->threads = (pthread_t *) malloc(num_threads * sizeof(pthread_t));
+    pool->workers = (thread_pool_worker *) calloc(num_threads, sizeof(thread_pool_worker));
+    if (pool->threads == NULL || pool->workers == NULL){
+        free(pool->threads);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->task_ready, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+    for (uint32_t i = 0; i < num_threads; i++){
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pthread_mutex_init(&pool->workers[i].deque.lock, NULL);
+    }
+
+    pool->num_threads = num_threads;
+    for (uint32_t i = 0; i < num_threads; i++){
+        if (pthread_create(&pool->threads[i], NULL, thread_pool_worker_main, &pool->workers[i]) != 0){
+            pool->num_threads = i;
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void thread_pool_submit (thread_pool *pool, thread_pool_fn fn, void *arg){
+    thread_pool_task *task = (thread_pool_task *) malloc(sizeof(thread_pool_task));
+    thread_pool_worker *worker = thread_pool_current_worker;
+
+    // out of memory: run it on the caller's thread rather than dropping it
+    if (task == NULL){
+        fn(arg);
+        return;
+    }
+    task->fn = fn;
+    task->arg = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    if (worker == NULL || worker->pool != pool){
+        worker = &pool->workers[pool->next_deque++ % pool->num_threads];
+    }
+    thread_pool_push(&worker->deque, task);
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&pool->task_ready);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// blocks until every task submitted so far has finished, must not be called from inside a task
+void thread_pool_wait (thread_pool *pool){
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0){
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
\ No newline at end of file
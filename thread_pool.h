@@ -0,0 +1,21 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <stdint.h>
+
+typedef void (*thread_pool_fn) (void *arg);
+
+typedef struct thread_pool thread_pool;
+
+#include "thread_pool.c"
+
+thread_pool *thread_pool_create (uint32_t num_threads);
+
+void thread_pool_submit (thread_pool *pool, thread_pool_fn fn, void *arg);
+
+void thread_pool_wait (thread_pool *pool);
+
+void thread_pool_destroy (thread_pool *pool);
+
+uint32_t thread_pool_default_threads (void);
+
+#endif
\ No newline at end of file